@@ -3,8 +3,11 @@
 #include "freertos/semphr.h"
 #include "freertos/task.h"
 
+#include "string.h"
+
 #include "stm_log.h"
 #include "include/hd44780.h"
+#include "include/hd44780_charset.h"
 
 #define TICK_DELAY_DEFAULT		100
 #define I2C_ADDR				(0x27<<1)
@@ -22,11 +25,155 @@
 #define HOME_ERR_STR				"lcd home error"
 #define GOTOXY_ERR_STR				"lcd goto position (x,y) error"
 #define SHIFT_CURSOR_ERR_STR		"lcd shift cursor error"
-
+#define WRITE_UTF8_ERR_STR			"lcd write utf8 error"
+#define SET_CHARSET_ERR_STR			"lcd set charset error"
+#define LOAD_CUSTOM_CHAR_ERR_STR	"lcd load custom char error"
+#define CALIBRATE_ERR_STR			"lcd calibrate timing error"
+#define TIMING_ERR_STR				"lcd timing profile error"
+#define TRACE_ERR_STR				"lcd trace error"
+#define FB_WRITE_ERR_STR			"lcd frame buffer write error"
+#define FLUSH_ERR_STR				"lcd flush error"
+#define VIEWPORT_ERR_STR			"lcd set viewport error"
+#define FIELD_ERR_STR				"lcd field error"
+#define NUMBER_ERR_STR				"lcd number error"
+#define PAGE_ERR_STR				"lcd page error"
+#define RESYNC_ERR_STR				"lcd resync error"
+#define COST_ERR_STR				"lcd cost error"
+#define GROUP_ERR_STR				"lcd group error"
+#define TEMPLATE_ERR_STR			"lcd template error"
+#define CONSOLE_ERR_STR				"lcd console error"
+#define WIDGET_ERR_STR				"lcd widget error"
+#define BUS_HOLD_ERR_STR			"lcd bus hold error"
+#define I2C_WRITE_ERR_STR			"lcd i2c write error"
+#define DISPLAY_ERR_STR				"lcd display error"
+#define BACKLIGHT_ERR_STR			"lcd backlight error"
+#define ANIM_ERR_STR				"lcd animation error"
+
+#define LCD_NUM_CGRAM_SLOT			8
+
+#define LCD_DDRAM_LINE_SIZE			40
+#define LCD_DDRAM_SIZE				(2 * LCD_DDRAM_LINE_SIZE)
+#define LCD_MAX_CTRL				2			/* 40x4 LCD has two controllers */
+
+#define US_PER_TICK					(portTICK_PERIOD_MS * 1000)
+#define CALIBRATE_NUM_SAMPLE		4
+#define TIMING_MAX_US				100000		/* Reject profiles with execution time above 100 ms */
+#define FIELD_READ_RETRY			4			/* Field still being written is left for next render */
+#define LCD_POWER_ON_DELAY_MS		50			/* Supply rise to first instruction, at least 40 ms */
+#define LCD_POWER_ON_RESET_US		4100		/* First nibble reset after power on */
+#define LCD_RESET_NIBBLE_US			100			/* Second nibble reset, at least 100 us */
+#define LCD_SYNC_CHECK_WRITES		32			/* Writes between automatic address counter checks */
+#define LCD_EN_HOLD_LOOP			32			/* Busy loop iterations of each EN edge, above 450 ns up to 200 MHz */
+#define LCD_EN_HOLD_US				1			/* Each EN edge of parallel bus is held about this long */
+#define LCD_I2C_SPEED_DEFAULT		100000		/* Assumed when hw_info does not set I2C speed */
+#define LCD_INT_TEXT_SIZE			12			/* "-2147483648" and terminating NUL */
+#define LCD_BATCH_SIZE				64			/* Serial bytes of one flush transaction, 16 writes */
+#define LCD_BACKLIGHT				0x08		/* Expander output driving backlight */
+#define GROUP_TASK_STACK_SIZE		512			/* Default words, flush keeps a batch buffer on stack */
+#define CONSOLE_TAB_SIZE			4
+#define BIG_CHAR_WIDTH				3			/* Columns of a big character, followed by one blank column */
+#define FULL_BLOCK_CP				0x2588
+
+typedef enum {
+	CGRAM_KIND_FREE = 0,						/* Slot can be used for fallback or widget glyph */
+	CGRAM_KIND_FALLBACK,						/* Fallback glyph of code point in cgram_owner */
+	CGRAM_KIND_USER,							/* Slot loaded by hd44780_load_custom_char */
+	CGRAM_KIND_WIDGET,							/* Widget glyph, id in cgram_owner */
+	CGRAM_KIND_ANIM,							/* Slot rewritten by hd44780_anim_tick */
+} cgram_kind_t;
+
+typedef enum {
+	WIDGET_GLYPH_HBAR_1 = 0,					/* Left columns, 1 to 4 of 5 */
+	WIDGET_GLYPH_VBAR_1 = 4,					/* Bottom rows, 1 to 7 of 8 */
+	WIDGET_GLYPH_BIG_UB = 11,					/* Upper bar of big characters */
+	WIDGET_GLYPH_BIG_UMB = 12,					/* Upper and middle bars of big characters */
+	WIDGET_GLYPH_FULL = 13,						/* Used from character ROM when available */
+	WIDGET_GLYPH_MAX,
+	WIDGET_GLYPH_BLANK = 0xFF,
+} widget_glyph_t;
+
+#define WIDGET_GLYPH_BIG_LB			(WIDGET_GLYPH_VBAR_1 + 1)	/* Lower bar, same as two bottom rows */
+
+static const uint8_t widget_glyph[WIDGET_GLYPH_MAX][8] = {
+	{0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10},
+	{0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18},
+	{0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C},
+	{0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E},
+	{0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F},
+	{0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F, 0x1F},
+	{0x00, 0x00, 0x00, 0x00, 0x00, 0x1F, 0x1F, 0x1F},
+	{0x00, 0x00, 0x00, 0x00, 0x1F, 0x1F, 0x1F, 0x1F},
+	{0x00, 0x00, 0x00, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F},
+	{0x00, 0x00, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F},
+	{0x00, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F},
+	{0x1F, 0x1F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+	{0x1F, 0x1F, 0x00, 0x00, 0x00, 0x00, 0x1F, 0x1F},
+	{0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F},
+};
+
+#define _F		WIDGET_GLYPH_FULL
+#define _U		WIDGET_GLYPH_BIG_UB
+#define _M		WIDGET_GLYPH_BIG_UMB
+#define _L		WIDGET_GLYPH_BIG_LB
+#define __		WIDGET_GLYPH_BLANK
+
+/* Top row then bottom row, middle bar is the bottom of top row */
+static const struct {
+	char 		chr;
+	uint8_t 	glyph[2 * BIG_CHAR_WIDTH];
+} big_char[] = {
+	{'0', {_F, _U, _F, _F, _L, _F}},
+	{'1', {_U, _F, __, _L, _F, _L}},
+	{'2', {_M, _M, _F, _F, _L, _L}},
+	{'3', {_M, _M, _F, _L, _L, _F}},
+	{'4', {_F, _L, _F, __, __, _F}},
+	{'5', {_F, _M, _M, _L, _L, _F}},
+	{'6', {_F, _M, _M, _F, _L, _F}},
+	{'7', {_U, _U, _F, __, __, _F}},
+	{'8', {_F, _M, _F, _F, _L, _F}},
+	{'9', {_F, _M, _F, _L, _L, _F}},
+	{'-', {_L, _L, _L, __, __, __}},
+	{'#', {_M, _M, _M, _L, _L, _L}},
+	{' ', {__, __, __, __, __, __}},
+};
+
+#undef _F
+#undef _U
+#undef _M
+#undef _L
+#undef __
+
+static const struct {
+	uint8_t 	cols;
+	uint8_t 	rows;
+	uint8_t 	row_addr[4];				/* DDRAM address of first column of each row */
+	uint8_t 	row_ctrl[4];				/* Controller driving each row */
+	uint8_t 	num_ctrl;
+	bool 		hw_scroll;					/* Each row owns a DDRAM line, display shift is usable */
+} lcd_geometry[HD44780_SIZE_MAX] = {
+	[HD44780_SIZE_16_2] = {16, 2, {0x00, 0x40, 0x10, 0x50}, {0, 0, 0, 0}, 1, true},
+	[HD44780_SIZE_16_4] = {16, 4, {0x00, 0x40, 0x10, 0x50}, {0, 0, 0, 0}, 1, false},
+	[HD44780_SIZE_20_4] = {20, 4, {0x00, 0x40, 0x14, 0x54}, {0, 0, 0, 0}, 1, false},
+	[HD44780_SIZE_40_4] = {40, 4, {0x00, 0x40, 0x00, 0x40}, {0, 0, 1, 1}, 2, true},
+};
+
+static const hd44780_timing_t timing_default = {
+	.clear_us = 2000,
+	.home_us = 2000,
+	.cmd_us = 50,
+	.data_us = 50,
+};
+
+#ifdef HD44780_SINGLE_OWNER
+/* One task owns the LCD, handle is never shared */
+#define mutex_lock(x)			do {} while (0)
+#define mutex_unlock(x) 		do {} while (0)
+#else
 #define mutex_lock(x)			while (xSemaphoreTake(x, portMAX_DELAY) != pdPASS)
 #define mutex_unlock(x) 		xSemaphoreGive(x)
 #define mutex_create()			xSemaphoreCreateMutex()
 #define mutex_destroy(x) 		vQueueDelete(x)
+#endif
 
 static const char *TAG = "HD44780";
 
@@ -38,19 +185,77 @@ static const char *TAG = "HD44780";
 typedef stm_err_t (*init_func)(hd44780_hw_info_t hw_info);
 typedef stm_err_t (*write_func)(hd44780_hw_info_t hw_info, uint8_t data);
 typedef stm_err_t (*read_func)(hd44780_hw_info_t hw_info, uint8_t *buf);
-typedef void (*wait_func)(hd44780_handle_t handle);
+typedef void (*wait_func)(hd44780_handle_t handle, uint8_t cmd);
+
+typedef struct {
+	hd44780_hw_info_t			hw_info;							/* Hardware information with EN pin of this controller */
+	uint8_t 					addr;								/* Mirror of address counter */
+	bool 						addr_cgram;							/* Address counter points to CGRAM */
+	uint8_t 					shift;								/* Display shift, visible column 0 shows DDRAM column shift */
+	uint8_t 					lcd_addr;							/* Address counter left on controller while display is off */
+	uint32_t 					ready_us;							/* Controller accepts next write from this time */
+	uint8_t 					pending;							/* Instruction still executing until ready_us, 0 for data */
+	bool 						lcd_addr_cgram;
+	uint8_t 					lcd_shift;
+	uint8_t 					*shadow;							/* DDRAM content of controller */
+	uint8_t 					*fb;								/* DDRAM content to be flushed */
+} hd44780_ctrl_t;
+
+typedef struct {
+	int 						pos;								/* Cell address counter points to, -1 if unknown */
+	int 						scan;								/* Next cell to check */
+	int 						left;								/* Cells not checked yet */
+} hd44780_sweep_t;
 
 typedef struct hd44780 {
 	hd44780_size_t 				size;
 	hd44780_comm_mode_t 		comm_mode;
-	hd44780_hw_info_t			hw_info;
+	bool 						is_static;							/* Storage provided by hd44780_init_static */
 	write_func 					_write_cmd;
 	write_func 					_write_data;
 	wait_func 					_wait;
+#ifndef HD44780_SINGLE_OWNER
 	SemaphoreHandle_t			lock;
+#endif
+	hd44780_get_time_us_t 		get_time_us;
+	hd44780_timing_t 			timing;
+	bool 						trace_on;
+	hd44780_trace_event_t 		*trace_buf;							/* Trace ring buffer */
+	uint32_t 					trace_size;
+	uint32_t 					trace_head;							/* Index of next event */
+	uint32_t 					trace_count;
+	uint32_t 					trace_dropped;
+	hd44780_charset_t 			charset;
+	uint16_t 					cgram_owner[LCD_NUM_CGRAM_SLOT];	/* Code point or widget glyph id loaded in each CGRAM slot */
+	uint8_t 					cgram_kind[LCD_NUM_CGRAM_SLOT];		/* What each CGRAM slot is used for, cgram_kind_t */
+	uint8_t 					cgram[LCD_NUM_CGRAM_SLOT * 8];		/* CGRAM content, replayed on resync */
+	write_func 					_write_nibble;
+	uint8_t 					status;								/* Busy flag and address counter of last read */
+	bool 						resyncing;
+	hd44780_cost_t 				cost;								/* Flush planner cost model, zero to derive from bus */
+	uint8_t 					*batch;								/* Serial writes queued for one transaction, NULL if not batching */
+	uint8_t 					batch_len;
+	bool 						display_on;
+	uint8_t 					backlight;							/* Expander backlight bit, ORed into each serial byte */
+	uint8_t 					cgram_dirty;						/* CGRAM slots written while display is off */
+	uint32_t 					hold_max_us;						/* I2C transfers are split to hold bus at most this long, 0 if no limit */
+	uint32_t 					hold_worst_us;						/* Longest I2C transfer measured */
+	hd44780_field_t 			*fields;							/* Registered fields, rendered by hd44780_field_render */
+	const hd44780_page_t 		*page;								/* Page shown on LCD, NULL if none */
+	hd44780_ctrl_t 				ctrl[LCD_MAX_CTRL];
+	uint8_t 					num_ctrl;
+	uint8_t 					cur;								/* Controller addressed by direct writes */
+	uint8_t 					sync_writes;						/* Writes since address counter was last checked */
 } hd44780_t;
 
 
+static void _en_hold(void)
+{
+	/* Enable pulse needs 450 ns, far shorter than any RTOS delay */
+	for (volatile uint32_t i = 0; i < LCD_EN_HOLD_LOOP; i++) {
+	}
+}
+
 stm_err_t _init_mode_4bit(hd44780_hw_info_t hw_info)
 {
 	gpio_cfg_t gpio_cfg;
@@ -137,9 +342,9 @@ stm_err_t _write_cmd_4bit(hd44780_hw_info_t hw_info, uint8_t cmd)
 	HD44780_CHECK(!gpio_set_level(hw_info.gpio_port_d7, hw_info.gpio_num_d7, bit_data), WRITE_CMD_ERR_STR, return STM_FAIL);
 
 	HD44780_CHECK(!gpio_set_level(hw_info.gpio_port_en, hw_info.gpio_num_en, true), WRITE_CMD_ERR_STR, return STM_FAIL);
-	vTaskDelay(1 / portTICK_PERIOD_MS);
+	_en_hold();
 	HD44780_CHECK(!gpio_set_level(hw_info.gpio_port_en, hw_info.gpio_num_en, false), WRITE_CMD_ERR_STR, return STM_FAIL);
-	vTaskDelay(1 / portTICK_PERIOD_MS);
+	_en_hold();
 
 	bit_data = (nibble_l >> 0) & 0x01;
 	HD44780_CHECK(!gpio_set_level(hw_info.gpio_port_d4, hw_info.gpio_num_d4, bit_data), WRITE_CMD_ERR_STR, return STM_FAIL);
@@ -151,9 +356,9 @@ stm_err_t _write_cmd_4bit(hd44780_hw_info_t hw_info, uint8_t cmd)
 	HD44780_CHECK(!gpio_set_level(hw_info.gpio_port_d7, hw_info.gpio_num_d7, bit_data), WRITE_CMD_ERR_STR, return STM_FAIL);
 
 	HD44780_CHECK(!gpio_set_level(hw_info.gpio_port_en, hw_info.gpio_num_en, true), WRITE_CMD_ERR_STR, return STM_FAIL);
-	vTaskDelay(1 / portTICK_PERIOD_MS);
+	_en_hold();
 	HD44780_CHECK(!gpio_set_level(hw_info.gpio_port_en, hw_info.gpio_num_en, false), WRITE_CMD_ERR_STR, return STM_FAIL);
-	vTaskDelay(1 / portTICK_PERIOD_MS);
+	_en_hold();
 
 	return STM_OK;
 }
@@ -163,19 +368,62 @@ stm_err_t _write_cmd_8bit(hd44780_hw_info_t hw_info, uint8_t cmd)
 	return STM_OK;
 }
 
-stm_err_t _write_cmd_serial(hd44780_hw_info_t hw_info, uint8_t cmd)
+static void _encode_cmd_serial(uint8_t *buf, uint8_t cmd, uint8_t bl)
+{
+	buf[0] = (cmd & 0xF0) | 0x04 | bl;
+	buf[1] = (cmd & 0xF0) | bl;
+	buf[2] = ((cmd << 4) & 0xF0) | 0x04 | bl;
+	buf[3] = ((cmd << 4) & 0xF0) | bl;
+}
+
+static void _encode_data_serial(uint8_t *buf, uint8_t data, uint8_t bl)
+{
+	buf[0] = (data & 0xF0) | 0x05 | bl;
+	buf[1] = (data & 0xF0) | 0x01 | bl;
+	buf[2] = ((data << 4) & 0xF0) | 0x05 | bl;
+	buf[3] = ((data << 4) & 0xF0) | 0x01 | bl;
+}
+
+static void _encode_nibble_serial(uint8_t *buf, uint8_t nibble, uint8_t bl)
 {
-	uint8_t buf_send[4];
-	buf_send[0] = (cmd & 0xF0) | 0x04;
-	buf_send[1] = (cmd & 0xF0);
-	buf_send[2] = ((cmd << 4) & 0xF0) | 0x04;
-	buf_send[3] = ((cmd << 4) & 0xF0) | 0x08;
+	buf[0] = (nibble << 4) | 0x04 | bl;
+	buf[1] = (nibble << 4) | bl;
+}
+
+stm_err_t _write_nibble_4bit(hd44780_hw_info_t hw_info, uint8_t nibble)
+{
+	bool bit_data;
 
-	HD44780_CHECK(!i2c_master_write_bytes(hw_info.i2c_num, I2C_ADDR, buf_send, 4, TICK_DELAY_DEFAULT), WRITE_CMD_ERR_STR, return STM_FAIL);
+	/* Set hw_info RS to write to command register */
+	HD44780_CHECK(!gpio_set_level(hw_info.gpio_port_rs, hw_info.gpio_num_rs, false), WRITE_CMD_ERR_STR, return STM_FAIL);
+
+	if ((hw_info.gpio_port_rw != -1) && (hw_info.gpio_num_rw != -1)) {
+		HD44780_CHECK(!gpio_set_level(hw_info.gpio_port_rw, hw_info.gpio_num_rw, false), WRITE_CMD_ERR_STR, return STM_FAIL);
+	}
+
+	/* Write single nibble, used to bring controller back in step */
+	bit_data = (nibble >> 0) & 0x01;
+	HD44780_CHECK(!gpio_set_level(hw_info.gpio_port_d4, hw_info.gpio_num_d4, bit_data), WRITE_CMD_ERR_STR, return STM_FAIL);
+	bit_data = (nibble >> 1) & 0x01;
+	HD44780_CHECK(!gpio_set_level(hw_info.gpio_port_d5, hw_info.gpio_num_d5, bit_data), WRITE_CMD_ERR_STR, return STM_FAIL);
+	bit_data = (nibble >> 2) & 0x01;
+	HD44780_CHECK(!gpio_set_level(hw_info.gpio_port_d6, hw_info.gpio_num_d6, bit_data), WRITE_CMD_ERR_STR, return STM_FAIL);
+	bit_data = (nibble >> 3) & 0x01;
+	HD44780_CHECK(!gpio_set_level(hw_info.gpio_port_d7, hw_info.gpio_num_d7, bit_data), WRITE_CMD_ERR_STR, return STM_FAIL);
+
+	HD44780_CHECK(!gpio_set_level(hw_info.gpio_port_en, hw_info.gpio_num_en, true), WRITE_CMD_ERR_STR, return STM_FAIL);
+	_en_hold();
+	HD44780_CHECK(!gpio_set_level(hw_info.gpio_port_en, hw_info.gpio_num_en, false), WRITE_CMD_ERR_STR, return STM_FAIL);
+	_en_hold();
 
 	return STM_OK;
 }
 
+stm_err_t _write_nibble_8bit(hd44780_hw_info_t hw_info, uint8_t nibble)
+{
+	return _write_cmd_8bit(hw_info, nibble << 4);
+}
+
 stm_err_t _write_data_4bit(hd44780_hw_info_t hw_info, uint8_t data)
 {
 	bool bit_data;
@@ -200,9 +448,9 @@ stm_err_t _write_data_4bit(hd44780_hw_info_t hw_info, uint8_t data)
 	HD44780_CHECK(!gpio_set_level(hw_info.gpio_port_d7, hw_info.gpio_num_d7, bit_data), WRITE_DATA_ERR_STR, return STM_FAIL);
 
 	HD44780_CHECK(!gpio_set_level(hw_info.gpio_port_en, hw_info.gpio_num_en, true), WRITE_DATA_ERR_STR, return STM_FAIL);
-	vTaskDelay(1 / portTICK_PERIOD_MS);
+	_en_hold();
 	HD44780_CHECK(!gpio_set_level(hw_info.gpio_port_en, hw_info.gpio_num_en, false), WRITE_DATA_ERR_STR, return STM_FAIL);
-	vTaskDelay(1 / portTICK_PERIOD_MS);
+	_en_hold();
 
 	bit_data = (nibble_l >> 0) & 0x01;
 	HD44780_CHECK(!gpio_set_level(hw_info.gpio_port_d4, hw_info.gpio_num_d4, bit_data), WRITE_DATA_ERR_STR, return STM_FAIL);
@@ -214,9 +462,9 @@ stm_err_t _write_data_4bit(hd44780_hw_info_t hw_info, uint8_t data)
 	HD44780_CHECK(!gpio_set_level(hw_info.gpio_port_d7, hw_info.gpio_num_d7, bit_data), WRITE_DATA_ERR_STR, return STM_FAIL);
 
 	HD44780_CHECK(!gpio_set_level(hw_info.gpio_port_en, hw_info.gpio_num_en, true), WRITE_DATA_ERR_STR, return STM_FAIL);
-	vTaskDelay(1 / portTICK_PERIOD_MS);
+	_en_hold();
 	HD44780_CHECK(!gpio_set_level(hw_info.gpio_port_en, hw_info.gpio_num_en, false), WRITE_DATA_ERR_STR, return STM_FAIL);
-	vTaskDelay(1 / portTICK_PERIOD_MS);
+	_en_hold();
 
 	return STM_OK;
 }
@@ -226,19 +474,6 @@ stm_err_t _write_data_8bit(hd44780_hw_info_t hw_info, uint8_t data)
 	return STM_OK;
 }
 
-stm_err_t _write_data_serial(hd44780_hw_info_t hw_info, uint8_t data)
-{
-	uint8_t buf_send[4];
-	buf_send[0] = (data & 0xF0) | 0x0D;
-	buf_send[1] = (data & 0xF0) | 0x09;
-	buf_send[2] = ((data << 4) & 0xF0) | 0x0D;
-	buf_send[3] = ((data << 4) & 0xF0) | 0x09;
-
-	HD44780_CHECK(!i2c_master_write_bytes(hw_info.i2c_num, I2C_ADDR, buf_send, 4, TICK_DELAY_DEFAULT), WRITE_DATA_ERR_STR, return STM_FAIL);
-
-	return STM_OK;
-}
-
 stm_err_t _read_4bit(hd44780_hw_info_t hw_info, uint8_t *buf)
 {
 	gpio_cfg_t gpio_cfg;
@@ -267,7 +502,7 @@ stm_err_t _read_4bit(hd44780_hw_info_t hw_info, uint8_t *buf)
 
 	/* Read high nibble */
 	HD44780_CHECK(!gpio_set_level(hw_info.gpio_port_en, hw_info.gpio_num_en, true), READ_ERR_STR, return STM_FAIL);
-	vTaskDelay(1 / portTICK_PERIOD_MS);
+	_en_hold();
 	bit_data = gpio_get_level(hw_info.gpio_port_d4, hw_info.gpio_num_d4);
 	if (bit_data)
 		nibble_h |= (1 << 0);
@@ -281,11 +516,11 @@ stm_err_t _read_4bit(hd44780_hw_info_t hw_info, uint8_t *buf)
 	if (bit_data)
 		nibble_h |= (1 << 3);
 	HD44780_CHECK(!gpio_set_level(hw_info.gpio_port_en, hw_info.gpio_num_en, false), READ_ERR_STR, return STM_FAIL);
-	vTaskDelay(1 / portTICK_PERIOD_MS);
+	_en_hold();
 
 	/* Read low nibble */
 	HD44780_CHECK(!gpio_set_level(hw_info.gpio_port_en, hw_info.gpio_num_en, true), READ_ERR_STR, return STM_FAIL);
-	vTaskDelay(1 / portTICK_PERIOD_MS);
+	_en_hold();
 	bit_data = gpio_get_level(hw_info.gpio_port_d4, hw_info.gpio_num_d4);
 	if (bit_data)
 		nibble_l |= (1 << 0);
@@ -299,7 +534,7 @@ stm_err_t _read_4bit(hd44780_hw_info_t hw_info, uint8_t *buf)
 	if (bit_data)
 		nibble_l |= (1 << 3);
 	HD44780_CHECK(!gpio_set_level(hw_info.gpio_port_en, hw_info.gpio_num_en, false), READ_ERR_STR, return STM_FAIL);
-	vTaskDelay(1 / portTICK_PERIOD_MS);
+	_en_hold();
 
 	/* Set GPIOs as output mode */
 	gpio_cfg.mode = GPIO_OUTPUT_PP;
@@ -332,12 +567,63 @@ stm_err_t _read_8bit(hd44780_hw_info_t hw_info, uint8_t *buf)
 	return STM_OK;
 }
 
-static void _wait_with_delay(hd44780_handle_t handle)
+static uint32_t _get_time_us(hd44780_handle_t handle)
+{
+	if (handle->get_time_us) {
+		return handle->get_time_us();
+	}
+
+	return xTaskGetTickCount() * US_PER_TICK;
+}
+
+static void _delay_us(hd44780_handle_t handle, uint32_t us)
+{
+	/* Without microsecond time source, round up to RTOS tick */
+	if (handle->get_time_us == NULL) {
+		vTaskDelay((us + US_PER_TICK - 1) / US_PER_TICK);
+		return;
+	}
+
+	uint32_t start = handle->get_time_us();
+	if (us >= US_PER_TICK) {
+		vTaskDelay(us / US_PER_TICK);
+	}
+	while ((uint32_t)(handle->get_time_us() - start) < us);
+}
+
+static uint32_t _get_exec_time_us(hd44780_timing_t *timing, uint8_t cmd)
+{
+	if (cmd == 0x01) {
+		return timing->clear_us;
+	} else if ((cmd & 0xFE) == 0x02) {
+		return timing->home_us;
+	}
+
+	return timing->cmd_us;
+}
+
+static int32_t _remain_us(hd44780_handle_t handle, hd44780_ctrl_t *ctrl)
+{
+	int32_t remain = ctrl->ready_us - _get_time_us(handle);
+
+	/* Deadline is never set further than one execution, older ones wrapped around */
+	if (remain > TIMING_MAX_US + US_PER_TICK) {
+		return 0;
+	}
+
+	return remain;
+}
+
+static void _wait_with_delay(hd44780_handle_t handle, uint8_t cmd)
 {
-	vTaskDelay(2 / portTICK_PERIOD_MS);
+	int32_t remain = _remain_us(handle, &handle->ctrl[handle->cur]);
+
+	if (remain > 0) {
+		_delay_us(handle, remain);
+	}
 }
 
-static void _wait_with_pinrw(hd44780_handle_t handle)
+static void _wait_with_pinrw(hd44780_handle_t handle, uint8_t cmd)
 {
 	read_func _read;
 	uint8_t temp_val;
@@ -350,14 +636,23 @@ static void _wait_with_pinrw(hd44780_handle_t handle)
 		_read = NULL;
 	}
 
+	hd44780_hw_info_t *hw_info = &handle->ctrl[handle->cur].hw_info;
+	uint32_t start = _get_time_us(handle);
+
 	while (1) {
-		gpio_set_level(handle->hw_info.gpio_port_rs, handle->hw_info.gpio_num_rs, false);
-		gpio_set_level(handle->hw_info.gpio_port_rw, handle->hw_info.gpio_num_rw, true);
+		gpio_set_level(hw_info->gpio_port_rs, hw_info->gpio_num_rs, false);
+		gpio_set_level(hw_info->gpio_port_rw, hw_info->gpio_num_rw, true);
 
-		_read(handle->hw_info, &temp_val);
+		_read(*hw_info, &temp_val);
 		if ((temp_val & 0x80) == 0)
 			break;
+
+		/* Busy flag stuck, controller is likely out of step */
+		if ((uint32_t)(_get_time_us(handle) - start) > TIMING_MAX_US)
+			break;
 	}
+
+	handle->status = temp_val;
 }
 
 static init_func _get_init_func(hd44780_comm_mode_t comm_mode)
@@ -379,10 +674,21 @@ static write_func _get_write_cmd_func(hd44780_comm_mode_t comm_mode)
 		return _write_cmd_4bit;
 	} else if (comm_mode == HD44780_COMM_MODE_8BIT) {
 		return _write_cmd_8bit;
-	} else {
-		return _write_cmd_serial;
 	}
 
+	/* Serial writes go through _i2c_send */
+	return NULL;
+}
+
+static write_func _get_write_nibble_func(hd44780_comm_mode_t comm_mode)
+{
+	if (comm_mode == HD44780_COMM_MODE_4BIT) {
+		return _write_nibble_4bit;
+	} else if (comm_mode == HD44780_COMM_MODE_8BIT) {
+		return _write_nibble_8bit;
+	}
+
+	/* Serial writes go through _i2c_send */
 	return NULL;
 }
 
@@ -392,10 +698,9 @@ static write_func _get_write_data_func(hd44780_comm_mode_t comm_mode)
 		return _write_data_4bit;
 	} else if (comm_mode == HD44780_COMM_MODE_8BIT) {
 		return _write_data_8bit;
-	} else {
-		return _write_data_serial;
 	}
 
+	/* Serial writes go through _i2c_send */
 	return NULL;
 }
 
@@ -410,326 +715,2849 @@ static wait_func _get_wait_func(hd44780_hw_info_t hw_info)
 	return NULL;
 }
 
-void _hd44780_cleanup(hd44780_handle_t handle)
+static void _addr_increase(hd44780_ctrl_t *ctrl)
+{
+	if (ctrl->addr_cgram) {
+		ctrl->addr = (ctrl->addr + 1) & 0x3F;
+	} else if (ctrl->addr == 0x27) {
+		ctrl->addr = 0x40;
+	} else if (ctrl->addr == 0x67) {
+		ctrl->addr = 0x00;
+	} else {
+		ctrl->addr++;
+	}
+}
+
+static void _addr_decrease(hd44780_ctrl_t *ctrl)
 {
-	free(handle);
+	if (ctrl->addr_cgram) {
+		ctrl->addr = (ctrl->addr - 1) & 0x3F;
+	} else if (ctrl->addr == 0x40) {
+		ctrl->addr = 0x27;
+	} else if (ctrl->addr == 0x00) {
+		ctrl->addr = 0x67;
+	} else {
+		ctrl->addr--;
+	}
 }
 
-hd44780_handle_t hd44780_init(hd44780_cfg_t *config)
+static void _trace_record(hd44780_handle_t handle, hd44780_trace_type_t type, uint8_t value, uint32_t start)
 {
-	/* Check input condition */
-	HD44780_CHECK(config, INIT_ERR_STR, return NULL);
-	HD44780_CHECK(config->size < HD44780_SIZE_MAX, INIT_ERR_STR, return NULL);
-	HD44780_CHECK(config->comm_mode < HD44780_COMM_MODE_MAX, INIT_ERR_STR, return NULL);
+	uint32_t duration = _get_time_us(handle) - start;
+	hd44780_trace_event_t *event = &handle->trace_buf[handle->trace_head];
+
+	event->timestamp_us = start;
+	event->duration_us = (duration > 0xFFFF) ? 0xFFFF : duration;
+	event->type = type | (handle->cur ? HD44780_TRACE_CTRL_1 : 0);
+	event->value = value;
+
+	/* Oldest event is overwritten when ring buffer is full */
+	handle->trace_head = (handle->trace_head + 1) % handle->trace_size;
+	if (handle->trace_count < handle->trace_size) {
+		handle->trace_count++;
+	} else {
+		handle->trace_dropped++;
+	}
+}
 
-	/* Allocate memory for handle structure */
-	hd44780_handle_t handle = calloc(1, sizeof(hd44780_t));
-	HD44780_CHECK(handle, INIT_ERR_STR, return NULL);
+static void _trace_batch(hd44780_handle_t handle, uint32_t start, uint32_t num)
+{
+	uint32_t share = (_get_time_us(handle) - start) / num;
 
-	/* Make sure that RS pin not used in serial mode */
-	if (config->comm_mode == HD44780_COMM_MODE_SERIAL) {
-		config->hw_info.gpio_port_rw = -1;
-		config->hw_info.gpio_num_rw = -1;
+	/* Queued writes were recorded without bus time, each is charged its share of the transaction */
+	if (num > handle->trace_count) {
+		num = handle->trace_count;
 	}
+	uint32_t first = (handle->trace_head + handle->trace_size - num) % handle->trace_size;
+	for (uint32_t i = 0; i < num; i++) {
+		hd44780_trace_event_t *event = &handle->trace_buf[(first + i) % handle->trace_size];
+		event->timestamp_us = start + i * share;
+		event->duration_us = (share > 0xFFFF) ? 0xFFFF : share;
+	}
+}
 
-	/* Configure hw_infos */
-	if(!config->hw_info.is_init) {
-		init_func _init_func = _get_init_func(config->comm_mode);
-		HD44780_CHECK(!_init_func(config->hw_info), INIT_ERR_STR, {_hd44780_cleanup(handle); return NULL;});
+static int _ddram_index(uint8_t addr)
+{
+	if ((addr & 0x3F) >= LCD_DDRAM_LINE_SIZE) {
+		return -1;
 	}
 
-	write_func _write_cmd = _get_write_cmd_func(config->comm_mode);
-	
-	HD44780_CHECK(!_write_cmd(config->hw_info, 0x02), INIT_ERR_STR, {_hd44780_cleanup(handle); return NULL;});
-	vTaskDelay(TICK_DELAY_DEFAULT / portTICK_PERIOD_MS);
+	return ((addr & 0x40) ? LCD_DDRAM_LINE_SIZE : 0) + (addr & 0x3F);
+}
 
-	HD44780_CHECK(!_write_cmd(config->hw_info, 0x28), INIT_ERR_STR, {_hd44780_cleanup(handle); return NULL;});
-	vTaskDelay(TICK_DELAY_DEFAULT / portTICK_PERIOD_MS);
+static uint8_t _ddram_addr(int index)
+{
+	return (index >= LCD_DDRAM_LINE_SIZE) ? (0x40 | (index - LCD_DDRAM_LINE_SIZE)) : index;
+}
 
-	HD44780_CHECK(!_write_cmd(config->hw_info, 0x06), INIT_ERR_STR, {_hd44780_cleanup(handle); return NULL;});
-	vTaskDelay(TICK_DELAY_DEFAULT / portTICK_PERIOD_MS);
+static hd44780_ctrl_t *_cell_ctrl(hd44780_handle_t handle, uint8_t row)
+{
+	return &handle->ctrl[lcd_geometry[handle->size].row_ctrl[row]];
+}
 
-	HD44780_CHECK(!_write_cmd(config->hw_info, 0x0C), INIT_ERR_STR, {_hd44780_cleanup(handle); return NULL;});
-	vTaskDelay(TICK_DELAY_DEFAULT / portTICK_PERIOD_MS);
+static uint8_t _cell_addr(hd44780_handle_t handle, uint8_t col, uint8_t row)
+{
+	uint8_t base = lcd_geometry[handle->size].row_addr[row];
 
-	HD44780_CHECK(!_write_cmd(config->hw_info, 0x01), INIT_ERR_STR, {_hd44780_cleanup(handle); return NULL;});
-	vTaskDelay(TICK_DELAY_DEFAULT / portTICK_PERIOD_MS);
+	return (base & 0x40) | (((base & 0x3F) + col + _cell_ctrl(handle, row)->shift) % LCD_DDRAM_LINE_SIZE);
+}
 
-	/* Update handle structure */
-	handle->size = config->size;
-	handle->comm_mode = config->comm_mode;
-	handle->hw_info = config->hw_info;
-	handle->_write_cmd = _get_write_cmd_func(config->comm_mode);
-	handle->_write_data = _get_write_data_func(config->comm_mode);
-	handle->_wait = _get_wait_func(config->hw_info);
-	handle->lock = mutex_create();
+static void _mark_busy(hd44780_handle_t handle, hd44780_ctrl_t *ctrl, uint8_t cmd, uint32_t start, uint32_t exec_us)
+{
+	uint32_t end = _get_time_us(handle);
 
-	return handle;
+	ctrl->pending = cmd;
+
+	if (handle->get_time_us) {
+		/* First nibble of next transfer is latched no earlier than half way */
+		ctrl->ready_us = end + exec_us - (end - start) / 2;
+	} else if ((exec_us >= US_PER_TICK) || (handle->comm_mode != HD44780_COMM_MODE_SERIAL)) {
+		/* RTOS tick lags real time by up to one tick, parallel transfer is too short to cover execution */
+		ctrl->ready_us = end + exec_us + US_PER_TICK;
+	} else {
+		/* Shorter than a tick, covered by the next I2C transfer as before */
+		ctrl->ready_us = end;
+	}
 }
 
-stm_err_t hd44780_clear(hd44780_handle_t handle)
+static stm_err_t _resync(hd44780_handle_t handle, bool power_on);
+
+static uint32_t _i2c_byte_us(hd44780_handle_t handle)
 {
-	/* Check input condition */
-	HD44780_CHECK(handle, CLEAR_ERR_STR, return STM_ERR_INVALID_ARG);
+	uint32_t speed = handle->ctrl[0].hw_info.i2c_speed ? handle->ctrl[0].hw_info.i2c_speed : LCD_I2C_SPEED_DEFAULT;
 
-	mutex_lock(handle->lock);
+	/* 8 bits and acknowledge */
+	return 9000000 / speed;
+}
 
-	int ret = handle->_write_cmd(handle->hw_info, 0x01);
-	if (ret) {
-		STM_LOGE(TAG, CLEAR_ERR_STR);
-		mutex_unlock(handle->lock);
-		return STM_FAIL;
+static uint32_t _i2c_chunk_len(hd44780_handle_t handle)
+{
+	if (!handle->hold_max_us) {
+		return UINT32_MAX;
 	}
 
-	handle->_wait(handle);
+	/* Start, address and stop take about two bytes, see _get_cost */
+	uint32_t len = handle->hold_max_us / _i2c_byte_us(handle);
+	len = (len > 2) ? len - 2 : 0;
 
-	mutex_unlock(handle->lock);
+	/* Chunk ends on nibble boundary, EN high then EN low, controller waits for next nibble */
+	len &= ~1UL;
 
-	return STM_OK;
+	return (len < 2) ? 2 : len;
 }
 
-stm_err_t hd44780_home(hd44780_handle_t handle)
+static stm_err_t _i2c_send(hd44780_handle_t handle, const uint8_t *buf, uint16_t len)
 {
-	/* Check input condition */
-	HD44780_CHECK(handle, HOME_ERR_STR, return STM_ERR_INVALID_ARG);
+	hd44780_ctrl_t *ctrl = &handle->ctrl[handle->cur];
+	uint32_t chunk = _i2c_chunk_len(handle);
 
-	mutex_lock(handle->lock);
+	for (uint32_t sent = 0; sent < len; sent += chunk) {
+		uint32_t num = (len - sent < chunk) ? len - sent : chunk;
 
-	int ret = handle->_write_cmd(handle->hw_info, 0x02);
-	if (ret) {
-		STM_LOGE(TAG, HOME_ERR_STR);
-		mutex_unlock(handle->lock);
-		return STM_FAIL;
-	}
+		/* Bus is released between chunks, let other devices use it */
+		if (sent) {
+			taskYIELD();
+		}
 
-	handle->_wait(handle);
+		uint32_t start = _get_time_us(handle);
+		HD44780_CHECK(!i2c_master_write_bytes(ctrl->hw_info.i2c_num, I2C_ADDR, (uint8_t *)&buf[sent], num, TICK_DELAY_DEFAULT), I2C_WRITE_ERR_STR, return STM_FAIL);
 
-	mutex_unlock(handle->lock);
+		uint32_t hold = _get_time_us(handle) - start;
+		if (hold > handle->hold_worst_us) {
+			handle->hold_worst_us = hold;
+		}
+	}
 
 	return STM_OK;
 }
 
-stm_err_t hd44780_write_char(hd44780_handle_t handle, uint8_t chr)
+static void _get_cost(hd44780_handle_t handle, hd44780_cost_t *cost)
 {
-	/* Check input condition */
-	HD44780_CHECK(handle, WRITE_CHR_ERR_STR, return STM_ERR_INVALID_ARG);
+	uint32_t xfer_us;
 
-	mutex_lock(handle->lock);
+	if (handle->cost.cmd_us) {
+		*cost = handle->cost;
+		return;
+	}
 
-	int ret = handle->_write_data(handle->hw_info, chr);
-	if (ret) {
-		STM_LOGE(TAG, WRITE_CHR_ERR_STR);
-		mutex_unlock(handle->lock);
-		return STM_FAIL;
+	if (handle->comm_mode == HD44780_COMM_MODE_SERIAL) {
+		/* Start, address and stop, then four expander bytes per write */
+		cost->txn_us = 2 * _i2c_byte_us(handle);
+		xfer_us = 4 * _i2c_byte_us(handle);
+	} else {
+		cost->txn_us = 0;
+		xfer_us = ((handle->comm_mode == HD44780_COMM_MODE_4BIT) ? 4 : 2) * LCD_EN_HOLD_US;
 	}
 
-	mutex_unlock(handle->lock);
+	/* Execution overlaps transfer of next write */
+	cost->cmd_us = (xfer_us > handle->timing.cmd_us) ? xfer_us : handle->timing.cmd_us;
+	cost->data_us = (xfer_us > handle->timing.data_us) ? xfer_us : handle->timing.data_us;
+}
 
-	return STM_OK;
+static bool _batch_is_usable(hd44780_handle_t handle)
+{
+	/*
+	 * Last nibble of a queued write is latched on its last byte and first
+	 * nibble of next one two bytes later, as in _mark_busy. That gap must
+	 * cover execution of previous write.
+	 */
+	return (handle->comm_mode == HD44780_COMM_MODE_SERIAL) &&
+	       (2 * _i2c_byte_us(handle) >= handle->timing.cmd_us) &&
+	       (2 * _i2c_byte_us(handle) >= handle->timing.data_us);
 }
 
-stm_err_t hd44780_write_string(hd44780_handle_t handle, uint8_t *str)
+static bool _ac_is_in_sync(hd44780_handle_t handle)
 {
-	/* Check input condition */
-	HD44780_CHECK(handle, WRITE_STR_ERR_STR, return STM_ERR_INVALID_ARG);
-	HD44780_CHECK(str, WRITE_STR_ERR_STR, return STM_ERR_INVALID_ARG);
+	hd44780_ctrl_t *ctrl = &handle->ctrl[handle->cur];
 
-	mutex_lock(handle->lock);
-	int ret;
+	/* Address counter is updated tADD after busy flag clears, second read returns settled value */
+	_wait_with_pinrw(handle, ctrl->pending);
+	_wait_with_pinrw(handle, ctrl->pending);
 
-	while (*str) {
-		ret = handle->_write_data(handle->hw_info, *str);
-		if (ret) {
-			STM_LOGE(TAG, WRITE_STR_ERR_STR);
-			mutex_unlock(handle->lock);
-			return STM_FAIL;
+	return handle->status == ctrl->addr;
+}
+
+static void _send_wait(hd44780_handle_t handle)
+{
+	hd44780_ctrl_t *ctrl = &handle->ctrl[handle->cur];
+	uint32_t start = _get_time_us(handle);
+
+	/* Queued writes are paced by the bus, see _batch_is_usable */
+	if (handle->batch) {
+		return;
+	}
+
+	/* Address counter is compared with its mirror every few writes when RW pin allows */
+	bool check = false;
+	if ((handle->comm_mode == HD44780_COMM_MODE_4BIT) && (handle->_wait == _wait_with_pinrw) &&
+	    !handle->resyncing && handle->display_on) {
+		check = (++handle->sync_writes >= LCD_SYNC_CHECK_WRITES);
+	}
+
+	if (_remain_us(handle, ctrl) > 0) {
+		/* Busy flag can not be trusted while controller is brought back in step */
+		if (handle->resyncing) {
+			_wait_with_delay(handle, ctrl->pending);
+		} else {
+			handle->_wait(handle, ctrl->pending);
+		}
+		ctrl->ready_us = _get_time_us(handle);
+
+		if (handle->trace_on) {
+			_trace_record(handle, HD44780_TRACE_WAIT, ctrl->pending, start);
 		}
-		str++;
 	}
-	mutex_unlock(handle->lock);
 
-	return STM_OK;
+	if (check) {
+		handle->sync_writes = 0;
+		if (!_ac_is_in_sync(handle)) {
+			STM_LOGE(TAG, RESYNC_ERR_STR);
+			_resync(handle, false);
+		}
+	}
 }
 
-stm_err_t hd44780_write_int(hd44780_handle_t handle, int number)
+static stm_err_t _batch_send(hd44780_handle_t handle)
 {
-	/* Check input condition */
-	HD44780_CHECK(handle, WRITE_INT_ERR_STR, return STM_ERR_INVALID_ARG);
+	hd44780_ctrl_t *ctrl = &handle->ctrl[handle->cur];
 
-	mutex_lock(handle->lock);
+	if (!handle->batch_len) {
+		return STM_OK;
+	}
 
-	int ret;
+	uint32_t start = _get_time_us(handle);
+	if (_i2c_send(handle, handle->batch, handle->batch_len)) {
+		return STM_FAIL;
+	}
+	if (handle->trace_on) {
+		_trace_batch(handle, start, handle->batch_len / 4);
+	}
+	handle->batch_len = 0;
 
-	if (number < 0) {
-		ret = handle->_write_data(handle->hw_info, '-');
-		if (ret) {
-			STM_LOGE(TAG, WRITE_INT_ERR_STR);
-			mutex_unlock(handle->lock);
-			return STM_FAIL;
-		}
-		number *= -1;
+	/* Only the last queued write may still be executing */
+	uint32_t end = _get_time_us(handle);
+	_mark_busy(handle, ctrl, ctrl->pending, end, ctrl->pending ? _get_exec_time_us(&handle->timing, ctrl->pending) : handle->timing.data_us);
+
+	return STM_OK;
+}
+
+static void _batch_begin(hd44780_handle_t handle, uint8_t *buf)
+{
+	if (!_batch_is_usable(handle)) {
+		return;
 	}
 
-	int num_digit = 1;
-	int temp = number;
+	/* Instruction sent before the batch still needs its full time */
+	_send_wait(handle);
+	handle->batch = buf;
+	handle->batch_len = 0;
+}
+
+static stm_err_t _batch_end(hd44780_handle_t handle)
+{
+	int ret = STM_OK;
 
-	while (temp > 9) {
-		num_digit++;
-		temp /= 10;
+	if (handle->batch) {
+		ret = _batch_send(handle);
+		handle->batch = NULL;
 	}
 
-	uint8_t buf[num_digit];
-	sprintf((char*)buf, "%d", number);
+	return ret;
+}
 
-	for (int i = 0; i < num_digit; i++) {
-		ret = handle->_write_data(handle->hw_info, buf[i]);
-		if (ret) {
-			STM_LOGE(TAG, WRITE_INT_ERR_STR);
-			mutex_unlock(handle->lock);
-			return STM_FAIL;
+static stm_err_t _bus_write(hd44780_handle_t handle, uint8_t val, bool rs)
+{
+	hd44780_ctrl_t *ctrl = &handle->ctrl[handle->cur];
+
+	if (handle->comm_mode != HD44780_COMM_MODE_SERIAL) {
+		return rs ? handle->_write_data(ctrl->hw_info, val) : handle->_write_cmd(ctrl->hw_info, val);
+	}
+
+	if (!handle->batch) {
+		uint8_t buf[4];
+		if (rs) {
+			_encode_data_serial(buf, val, handle->backlight);
+		} else {
+			_encode_cmd_serial(buf, val, handle->backlight);
 		}
+		return _i2c_send(handle, buf, 4);
 	}
 
-	mutex_unlock(handle->lock);
+	/* Queue write, transaction is sent when batch is full or ends */
+	if ((handle->batch_len + 4 > LCD_BATCH_SIZE) && _batch_send(handle)) {
+		return STM_FAIL;
+	}
+	if (rs) {
+		_encode_data_serial(&handle->batch[handle->batch_len], val, handle->backlight);
+	} else {
+		_encode_cmd_serial(&handle->batch[handle->batch_len], val, handle->backlight);
+	}
+	handle->batch_len += 4;
 
 	return STM_OK;
 }
 
-stm_err_t hd44780_write_float(hd44780_handle_t handle, float number, uint8_t precision)
+static bool _display_is_off(hd44780_handle_t handle)
 {
-	/* Check input condition */
-	HD44780_CHECK(handle, WRITE_INT_ERR_STR, return STM_ERR_INVALID_ARG);
-
-	mutex_lock(handle->lock);
-
-	int ret;
+	/* Recovery must reach controller whatever the display state */
+	return !handle->display_on && !handle->resyncing;
+}
 
-	if (number < 0) {
-		ret = handle->_write_data(handle->hw_info, '-');
-		if (ret) {
-			STM_LOGE(TAG, WRITE_INT_ERR_STR);
-			mutex_unlock(handle->lock);
-			return STM_FAIL;
+static void _track_cmd(hd44780_ctrl_t *ctrl, uint8_t cmd, bool sent)
+{
+	/* Track address counter so that it can be restored after CGRAM access */
+	if (cmd & 0x80) {
+		ctrl->addr = cmd & 0x7F;
+		ctrl->addr_cgram = false;
+	} else if (cmd & 0x40) {
+		ctrl->addr = cmd & 0x3F;
+		ctrl->addr_cgram = true;
+	} else if ((cmd & 0xF8) == 0x10) {
+		if (cmd & 0x04) {
+			_addr_increase(ctrl);
+		} else {
+			_addr_decrease(ctrl);
+		}
+	} else if ((cmd & 0xF8) == 0x18) {
+		ctrl->shift = (ctrl->shift + ((cmd & 0x04) ? LCD_DDRAM_LINE_SIZE - 1 : 1)) % LCD_DDRAM_LINE_SIZE;
+	} else if ((cmd == 0x01) || ((cmd & 0xFE) == 0x02)) {
+		ctrl->addr = 0;
+		ctrl->addr_cgram = false;
+		ctrl->shift = 0;
+		if (cmd == 0x01) {
+			if (sent) {
+				memset(ctrl->shadow, ' ', LCD_DDRAM_SIZE);
+			}
+			memset(ctrl->fb, ' ', LCD_DDRAM_SIZE);
 		}
-		number *= -1;
 	}
+}
 
-	int num_digit = 1;
-	int temp = (int)number;
+static stm_err_t _send_cmd(hd44780_handle_t handle, uint8_t cmd)
+{
+	hd44780_ctrl_t *ctrl = &handle->ctrl[handle->cur];
 
-	while (temp > 9) {
-		num_digit++;
-		temp /= 10;
+	/* Only RAM state follows while display is off, differences are sent on wake */
+	if (_display_is_off(handle)) {
+		_track_cmd(ctrl, cmd, false);
+		return STM_OK;
 	}
 
-	uint8_t buf[num_digit + 1 + precision];
-	uint8_t float_format[7];
+	_send_wait(handle);
 
-	sprintf((char*)float_format, "%%.%df", precision);
-	sprintf((char*)buf, (const char*)float_format, number);
+	uint32_t start = _get_time_us(handle);
 
-	for (int i = 0; i < (num_digit + 1 + precision); i++) {
-		ret = handle->_write_data(handle->hw_info, buf[i]);
-		if (ret) {
-			STM_LOGE(TAG, WRITE_INT_ERR_STR);
-			mutex_unlock(handle->lock);
-			return STM_FAIL;
-		}
+	if (_bus_write(handle, cmd, false)) {
+		return STM_FAIL;
 	}
+	_mark_busy(handle, ctrl, cmd, start, _get_exec_time_us(&handle->timing, cmd));
 
-	mutex_unlock(handle->lock);
+	if (handle->trace_on) {
+		_trace_record(handle, HD44780_TRACE_CMD, cmd, start);
+	}
+
+	_track_cmd(ctrl, cmd, true);
 
 	return STM_OK;
 }
 
-stm_err_t hd44780_gotoxy(hd44780_handle_t handle, uint8_t col, uint8_t row)
+static void _track_data(hd44780_handle_t handle, hd44780_ctrl_t *ctrl, uint8_t data, bool sent)
 {
-	/* Check input condition */
-	HD44780_CHECK(handle, GOTOXY_ERR_STR, return STM_ERR_INVALID_ARG);
+	/* Direct writes and flushes both leave frame buffer in sync */
+	int index = _ddram_index(ctrl->addr);
+	if (ctrl->addr_cgram) {
+		handle->cgram[ctrl->addr & 0x3F] = data;
+		if (!sent) {
+			handle->cgram_dirty |= 1 << ((ctrl->addr & 0x3F) >> 3);
+		}
+	} else if (index >= 0) {
+		if (sent) {
+			ctrl->shadow[index] = data;
+		}
+		ctrl->fb[index] = data;
+	}
 
-	mutex_lock(handle->lock);
+	_addr_increase(ctrl);
+}
+
+static stm_err_t _send_data(hd44780_handle_t handle, uint8_t data)
+{
+	hd44780_ctrl_t *ctrl = &handle->ctrl[handle->cur];
+
+	if (_display_is_off(handle)) {
+		_track_data(handle, ctrl, data, false);
+		return STM_OK;
+	}
+
+	_send_wait(handle);
+
+	uint32_t start = _get_time_us(handle);
+
+	if (_bus_write(handle, data, true)) {
+		return STM_FAIL;
+	}
+	_mark_busy(handle, ctrl, 0x00, start, handle->timing.data_us);
+
+	if (handle->trace_on) {
+		_trace_record(handle, HD44780_TRACE_DATA, data, start);
+	}
+
+	_track_data(handle, ctrl, data, true);
+
+	return STM_OK;
+}
+
+static stm_err_t _send_cmd_all(hd44780_handle_t handle, uint8_t cmd)
+{
+	/* Controllers execute concurrently, next access waits for remaining time */
+	for (handle->cur = 0; handle->cur < handle->num_ctrl; handle->cur++) {
+		if (_send_cmd(handle, cmd)) {
+			handle->cur = 0;
+			return STM_FAIL;
+		}
+	}
+	handle->cur = 0;
+
+	return STM_OK;
+}
+
+static stm_err_t _flush_cell(hd44780_handle_t handle, int index)
+{
+	hd44780_ctrl_t *ctrl = &handle->ctrl[handle->cur];
+
+	/* Address counter is reused across consecutive changed cells */
+	uint8_t addr = _ddram_addr(index);
+	if (ctrl->addr_cgram || (ctrl->addr != addr)) {
+		if (_send_cmd(handle, 0x80 | addr)) {
+			return STM_FAIL;
+		}
+	}
+
+	return _send_data(handle, ctrl->fb[index]);
+}
+
+static stm_err_t _flush_row(hd44780_handle_t handle, uint8_t col, uint8_t row, uint8_t len)
+{
+	uint8_t batch[LCD_BATCH_SIZE];
+	uint8_t cur = handle->cur;
+	int ret = STM_OK;
+
+	if (_display_is_off(handle)) {
+		return STM_OK;
+	}
+
+	handle->cur = lcd_geometry[handle->size].row_ctrl[row];
+	hd44780_ctrl_t *ctrl = &handle->ctrl[handle->cur];
+
+	_batch_begin(handle, batch);
+	for (uint8_t i = 0; !ret && (i < len); i++) {
+		int index = _ddram_index(_cell_addr(handle, col + i, row));
+		if (ctrl->fb[index] != ctrl->shadow[index]) {
+			ret = _flush_cell(handle, index);
+		}
+	}
+	if (_batch_end(handle)) {
+		ret = STM_FAIL;
+	}
+	handle->cur = cur;
+
+	return ret;
+}
+
+static void _sweep_init(hd44780_ctrl_t *ctrl, hd44780_sweep_t *sweep)
+{
+	/* Start where address counter points, cell order wraps like the counter */
+	sweep->pos = ctrl->addr_cgram ? -1 : _ddram_index(ctrl->addr);
+	sweep->scan = (sweep->pos < 0) ? 0 : sweep->pos;
+	sweep->left = LCD_DDRAM_SIZE;
+}
+
+static stm_err_t _sweep_step(hd44780_handle_t handle, hd44780_sweep_t *sweep, const hd44780_cost_t *cost, hd44780_plan_t *plan, bool send)
+{
+	hd44780_ctrl_t *ctrl = &handle->ctrl[handle->cur];
+	int gap = 0;
+
+	while ((gap < sweep->left) && (ctrl->fb[(sweep->scan + gap) % LCD_DDRAM_SIZE] == ctrl->shadow[(sweep->scan + gap) % LCD_DDRAM_SIZE])) {
+		gap++;
+	}
+	if (gap >= sweep->left) {
+		sweep->left = 0;
+		return STM_OK;
+	}
+
+	int dirty = (sweep->scan + gap) % LCD_DDRAM_SIZE;
+	int first = dirty;
+
+	if (sweep->pos != dirty) {
+		/* Rewrite unchanged cells when cheaper than moving address counter */
+		if ((sweep->pos == sweep->scan) && (gap * cost->data_us < cost->cmd_us)) {
+			first = sweep->scan;
+		} else {
+			plan->num_cmd++;
+			if (send && _send_cmd(handle, 0x80 | _ddram_addr(dirty))) {
+				return STM_FAIL;
+			}
+		}
+	}
+
+	for (int i = first; ; i = (i + 1) % LCD_DDRAM_SIZE) {
+		plan->num_data++;
+		if (i != dirty) {
+			plan->num_bridged++;
+		}
+		if (send && _send_data(handle, ctrl->fb[i])) {
+			return STM_FAIL;
+		}
+		if (i == dirty) {
+			break;
+		}
+	}
+
+	sweep->pos = (dirty + 1) % LCD_DDRAM_SIZE;
+	sweep->scan = sweep->pos;
+	sweep->left -= gap + 1;
+
+	return STM_OK;
+}
+
+static stm_err_t _flush_plan(hd44780_handle_t handle, hd44780_plan_t *plan, bool send)
+{
+	hd44780_sweep_t sweep[LCD_MAX_CTRL];
+	uint8_t batch[LCD_BATCH_SIZE];
+	hd44780_cost_t cost;
+	uint8_t cur = handle->cur;
+	bool pending = true;
+	int ret = STM_OK;
+
+	_get_cost(handle, &cost);
+	memset(plan, 0, sizeof(hd44780_plan_t));
+	for (uint8_t i = 0; i < handle->num_ctrl; i++) {
+		_sweep_init(&handle->ctrl[i], &sweep[i]);
+	}
+
+	if (send) {
+		_batch_begin(handle, batch);
+	}
+
+	/* Alternate controllers so that one executes while the other is fed */
+	while (!ret && pending) {
+		pending = false;
+		for (handle->cur = 0; !ret && (handle->cur < handle->num_ctrl); handle->cur++) {
+			if (sweep[handle->cur].left) {
+				pending = true;
+				ret = _sweep_step(handle, &sweep[handle->cur], &cost, plan, send);
+			}
+		}
+	}
+	handle->cur = cur;
+
+	if (send && _batch_end(handle)) {
+		ret = STM_FAIL;
+	}
+
+	uint32_t num_write = plan->num_cmd + plan->num_data;
+	if (_batch_is_usable(handle)) {
+		plan->num_txn = (num_write * 4 + LCD_BATCH_SIZE - 1) / LCD_BATCH_SIZE;
+	} else {
+		plan->num_txn = num_write;
+	}
+	plan->cost_us = plan->num_txn * cost.txn_us + plan->num_cmd * cost.cmd_us + plan->num_data * cost.data_us;
+
+	return ret;
+}
+
+static stm_err_t _flush(hd44780_handle_t handle)
+{
+	hd44780_plan_t plan;
+
+	/* Frame buffer is kept until wake */
+	if (_display_is_off(handle)) {
+		return STM_OK;
+	}
+
+	return _flush_plan(handle, &plan, true);
+}
+
+static stm_err_t _load_cgram(hd44780_handle_t handle, uint8_t slot, const uint8_t *pattern)
+{
+	uint8_t cur = handle->cur;
+	int ret = STM_OK;
+
+	/* Both controllers of 40x4 LCD need the same glyph */
+	for (handle->cur = 0; !ret && (handle->cur < handle->num_ctrl); handle->cur++) {
+		hd44780_ctrl_t *ctrl = &handle->ctrl[handle->cur];
+		uint8_t addr = ctrl->addr;
+		bool addr_cgram = ctrl->addr_cgram;
+
+		ret = _send_cmd(handle, 0x40 | (slot << 3));
+		for (uint8_t i = 0; !ret && (i < 8); i++) {
+			ret = _send_data(handle, pattern[i]);
+		}
+
+		/* Restore address counter */
+		if (!ret) {
+			ret = _send_cmd(handle, (addr_cgram ? 0x40 : 0x80) | addr);
+		}
+	}
+	handle->cur = cur;
+
+	return ret;
+}
+
+static stm_err_t _shift_display(hd44780_handle_t handle, uint8_t shift)
+{
+	hd44780_ctrl_t *ctrl = &handle->ctrl[handle->cur];
+	int ret = STM_OK;
+
+	/* Shift by shortest direction */
+	while (!ret && (ctrl->shift != shift)) {
+		if ((shift + LCD_DDRAM_LINE_SIZE - ctrl->shift) % LCD_DDRAM_LINE_SIZE <= LCD_DDRAM_LINE_SIZE / 2) {
+			ret = _send_cmd(handle, 0x18);
+		} else {
+			ret = _send_cmd(handle, 0x1C);
+		}
+	}
+
+	return ret;
+}
+
+static stm_err_t _send_nibble(hd44780_handle_t handle, uint8_t nibble, uint32_t exec_us)
+{
+	hd44780_ctrl_t *ctrl = &handle->ctrl[handle->cur];
+
+	_send_wait(handle);
+
+	uint32_t start = _get_time_us(handle);
+	int ret;
+
+	if (handle->comm_mode == HD44780_COMM_MODE_SERIAL) {
+		uint8_t buf[2];
+		_encode_nibble_serial(buf, nibble, handle->backlight);
+		ret = _i2c_send(handle, buf, 2);
+	} else {
+		ret = handle->_write_nibble(ctrl->hw_info, nibble);
+	}
+	if (ret) {
+		return STM_FAIL;
+	}
+	_mark_busy(handle, ctrl, nibble << 4, start, exec_us);
+
+	if (handle->trace_on) {
+		_trace_record(handle, HD44780_TRACE_CMD, nibble << 4, start);
+	}
+
+	return STM_OK;
+}
+
+static stm_err_t _resync_ctrl(hd44780_handle_t handle, bool power_on)
+{
+	hd44780_ctrl_t *ctrl = &handle->ctrl[handle->cur];
+	uint8_t shift = ctrl->shift;
+	uint8_t fb[LCD_DDRAM_SIZE];
+	int ret;
+
+	/*
+	 * Three 8bit function sets bring controller to 8bit mode whatever nibble
+	 * it waits for. First one may complete a pending byte, worst case is a
+	 * return home.
+	 */
+	ret = _send_nibble(handle, 0x3, power_on ? LCD_POWER_ON_RESET_US : handle->timing.home_us);
+	if (!ret) {
+		ret = _send_nibble(handle, 0x3, LCD_RESET_NIBBLE_US);
+	}
+	if (!ret) {
+		ret = _send_nibble(handle, 0x3, handle->timing.cmd_us);
+	}
+	if (!ret) {
+		ret = _send_nibble(handle, 0x2, handle->timing.cmd_us);
+	}
+
+	/* Clear makes DDRAM content known, frame buffer is kept for replay */
+	uint8_t init_cmd[] = {0x28, 0x06, handle->display_on ? 0x0C : 0x08, 0x01};
+
+	memcpy(fb, ctrl->fb, LCD_DDRAM_SIZE);
+	for (uint8_t i = 0; !ret && (i < sizeof(init_cmd)); i++) {
+		ret = _send_cmd(handle, init_cmd[i]);
+	}
+	memcpy(ctrl->fb, fb, LCD_DDRAM_SIZE);
+
+	if (!ret) {
+		ret = _shift_display(handle, shift);
+	}
+
+	return ret;
+}
+
+static void _save_lcd_state(hd44780_handle_t handle)
+{
+	/* Controller keeps this state while display is off */
+	for (uint8_t i = 0; i < handle->num_ctrl; i++) {
+		hd44780_ctrl_t *ctrl = &handle->ctrl[i];
+		ctrl->lcd_addr = ctrl->addr;
+		ctrl->lcd_addr_cgram = ctrl->addr_cgram;
+		ctrl->lcd_shift = ctrl->shift;
+	}
+	handle->cgram_dirty = 0;
+}
+
+static stm_err_t _replay(hd44780_handle_t handle, const uint8_t *addr, const bool *addr_cgram, uint8_t slots)
+{
+	uint8_t cur = handle->cur;
+	int ret = STM_OK;
+
+	/* Glyphs first, then screen content */
+	for (uint8_t slot = 0; !ret && (slot < LCD_NUM_CGRAM_SLOT); slot++) {
+		if (slots & (1 << slot)) {
+			ret = _load_cgram(handle, slot, &handle->cgram[slot * 8]);
+		}
+	}
+
+	if (!ret) {
+		ret = _flush(handle);
+	}
+
+	/* Restore address counter of direct writes */
+	for (handle->cur = 0; !ret && (handle->cur < handle->num_ctrl); handle->cur++) {
+		hd44780_ctrl_t *ctrl = &handle->ctrl[handle->cur];
+		if ((ctrl->addr != addr[handle->cur]) || (ctrl->addr_cgram != addr_cgram[handle->cur])) {
+			ret = _send_cmd(handle, (addr_cgram[handle->cur] ? 0x40 : 0x80) | addr[handle->cur]);
+		}
+	}
+	handle->cur = cur;
+
+	return ret;
+}
+
+static stm_err_t _resync(hd44780_handle_t handle, bool power_on)
+{
+	uint8_t cur = handle->cur;
+	uint8_t addr[LCD_MAX_CTRL];
+	bool addr_cgram[LCD_MAX_CTRL];
+	int ret = STM_OK;
+
+	handle->resyncing = true;
+
+	for (handle->cur = 0; !ret && (handle->cur < handle->num_ctrl); handle->cur++) {
+		addr[handle->cur] = handle->ctrl[handle->cur].addr;
+		addr_cgram[handle->cur] = handle->ctrl[handle->cur].addr_cgram;
+		ret = _resync_ctrl(handle, power_on);
+	}
+	handle->cur = cur;
+
+	/* Replay glyphs in use */
+	uint8_t slots = 0;
+	for (uint8_t slot = 0; slot < LCD_NUM_CGRAM_SLOT; slot++) {
+		if (handle->cgram_kind[slot] != CGRAM_KIND_FREE) {
+			slots |= 1 << slot;
+		}
+	}
+
+	if (!ret) {
+		ret = _replay(handle, addr, addr_cgram, slots);
+	}
+	handle->resyncing = false;
+
+	/* Display stays off, controller now holds RAM state */
+	if (!handle->display_on) {
+		_save_lcd_state(handle);
+	}
+
+	return ret;
+}
+
+static stm_err_t _send_display_ctrl(hd44780_handle_t handle, bool on)
+{
+	uint8_t cur = handle->cur;
+	int ret = STM_OK;
+
+	/* Cursor and blink stay off */
+	for (handle->cur = 0; !ret && (handle->cur < handle->num_ctrl); handle->cur++) {
+		ret = _send_cmd(handle, on ? 0x0C : 0x08);
+	}
+	handle->cur = cur;
+
+	return ret;
+}
+
+static stm_err_t _wake(hd44780_handle_t handle)
+{
+	uint8_t cur = handle->cur;
+	uint8_t addr[LCD_MAX_CTRL];
+	bool addr_cgram[LCD_MAX_CTRL];
+	int ret = STM_OK;
+
+	handle->display_on = true;
+
+	/* Mirrors go back to controller state, then only differences are sent */
+	for (handle->cur = 0; !ret && (handle->cur < handle->num_ctrl); handle->cur++) {
+		hd44780_ctrl_t *ctrl = &handle->ctrl[handle->cur];
+		uint8_t shift = ctrl->shift;
+
+		addr[handle->cur] = ctrl->addr;
+		addr_cgram[handle->cur] = ctrl->addr_cgram;
+		ctrl->addr = ctrl->lcd_addr;
+		ctrl->addr_cgram = ctrl->lcd_addr_cgram;
+		ctrl->shift = ctrl->lcd_shift;
+		ret = _shift_display(handle, shift);
+	}
+	handle->cur = cur;
+
+	if (!ret) {
+		ret = _replay(handle, addr, addr_cgram, handle->cgram_dirty);
+	}
+	handle->cgram_dirty = 0;
+
+	/* Content is complete when it becomes visible */
+	if (!ret) {
+		ret = _send_display_ctrl(handle, true);
+	}
+
+	return ret;
+}
+
+static stm_err_t _map_char(hd44780_handle_t handle, uint32_t cp, uint8_t *code)
+{
+	if (hd44780_charset_lookup(handle->charset, cp, code)) {
+		return STM_OK;
+	}
+
+	const uint8_t *pattern = hd44780_charset_glyph(cp);
+	if (pattern == NULL) {
+		*code = HD44780_CHARSET_REPLACEMENT;
+		return STM_OK;
+	}
+
+	/* Reuse glyph if already in CGRAM, else load it into a free slot */
+	int free_slot = -1;
+	for (uint8_t slot = 0; slot < LCD_NUM_CGRAM_SLOT; slot++) {
+		if ((handle->cgram_kind[slot] == CGRAM_KIND_FALLBACK) && (handle->cgram_owner[slot] == cp)) {
+			*code = slot;
+			return STM_OK;
+		}
+		if ((free_slot < 0) && (handle->cgram_kind[slot] == CGRAM_KIND_FREE)) {
+			free_slot = slot;
+		}
+	}
+
+	if (free_slot < 0) {
+		*code = HD44780_CHARSET_REPLACEMENT;
+		return STM_OK;
+	}
+
+	if (_load_cgram(handle, free_slot, pattern)) {
+		return STM_FAIL;
+	}
+	handle->cgram_kind[free_slot] = CGRAM_KIND_FALLBACK;
+	handle->cgram_owner[free_slot] = cp;
+	*code = free_slot;
+
+	return STM_OK;
+}
+
+static bool _timing_is_valid(const hd44780_timing_t *timing)
+{
+	return (timing->clear_us > 0) && (timing->clear_us <= TIMING_MAX_US) &&
+	       (timing->home_us > 0) && (timing->home_us <= TIMING_MAX_US) &&
+	       (timing->cmd_us > 0) && (timing->cmd_us <= TIMING_MAX_US) &&
+	       (timing->data_us > 0) && (timing->data_us <= TIMING_MAX_US);
+}
+
+static uint32_t _measure_cmd_us(hd44780_handle_t handle, uint8_t cmd)
+{
+	_send_wait(handle);
+	if (_send_cmd(handle, cmd)) {
+		return 0;
+	}
+
+	/* Execution starts on last EN falling edge, writer holds EN low one more delay */
+	uint32_t start = _get_time_us(handle) - LCD_EN_HOLD_US;
+	_wait_with_pinrw(handle, cmd);
+
+	return _get_time_us(handle) - start;
+}
+
+static uint32_t _measure_data_us(hd44780_handle_t handle, uint8_t data)
+{
+	_send_wait(handle);
+	if (_send_data(handle, data)) {
+		return 0;
+	}
+
+	uint32_t start = _get_time_us(handle) - LCD_EN_HOLD_US;
+	_wait_with_pinrw(handle, 0x00);
+
+	return _get_time_us(handle) - start;
+}
+
+static stm_err_t _calibrate_ctrl(hd44780_handle_t handle, hd44780_timing_t *measure)
+{
+	hd44780_ctrl_t *ctrl = &handle->ctrl[handle->cur];
+	uint8_t shift = ctrl->shift;
+	uint8_t fb[LCD_DDRAM_SIZE];
+	uint32_t clear_us, home_us, cmd_us, data_us;
+	int ret = STM_OK;
+
+	/* Clear blanks frame buffer too, content is kept for replay */
+	memcpy(fb, ctrl->fb, LCD_DDRAM_SIZE);
+
+	/* Keep worst sample of each instruction class */
+	for (uint8_t i = 0; !ret && (i < CALIBRATE_NUM_SAMPLE); i++) {
+		clear_us = _measure_cmd_us(handle, 0x01);
+		home_us = _measure_cmd_us(handle, 0x02);
+		cmd_us = _measure_cmd_us(handle, 0x06);
+		data_us = _measure_data_us(handle, ' ');
+		if (!clear_us || !home_us || !cmd_us || !data_us) {
+			ret = STM_FAIL;
+			break;
+		}
+
+		measure->clear_us = (clear_us > measure->clear_us) ? clear_us : measure->clear_us;
+		measure->home_us = (home_us > measure->home_us) ? home_us : measure->home_us;
+		measure->cmd_us = (cmd_us > measure->cmd_us) ? cmd_us : measure->cmd_us;
+		measure->data_us = (data_us > measure->data_us) ? data_us : measure->data_us;
+	}
+	memcpy(ctrl->fb, fb, LCD_DDRAM_SIZE);
+
+	if (!ret) {
+		ret = _shift_display(handle, shift);
+	}
+
+	return ret;
+}
+
+static void _release_fallback_glyphs(hd44780_handle_t handle)
+{
+	/* Widget glyphs stay loaded so that widgets can be redrawn without upload */
+	for (uint8_t slot = 0; slot < LCD_NUM_CGRAM_SLOT; slot++) {
+		if (handle->cgram_kind[slot] == CGRAM_KIND_FALLBACK) {
+			handle->cgram_kind[slot] = CGRAM_KIND_FREE;
+		}
+	}
+}
+
+/* Upper bound, enum size and padding depend on ABI */
+_Static_assert(sizeof(hd44780_t) <= HD44780_STATIC_SIZE, "HD44780_STATIC_SIZE too small");
+
+#ifdef HD44780_FOOTPRINT
+/* Symbol sized like handle structure, read by tools/footprint.sh */
+uint8_t hd44780_footprint_handle[sizeof(hd44780_t)];
+#endif
+
+#ifndef HD44780_SINGLE_OWNER
+typedef struct {
+	struct hd44780_group 		*group;
+	SemaphoreHandle_t 			start;								/* Given by commit */
+	TaskHandle_t 				task;
+	uint8_t 					panel[HD44780_GROUP_MAX_PANEL];		/* Panels on this bus, flushed in order */
+	uint8_t 					num_panel;
+} hd44780_group_bus_t;
+
+typedef struct hd44780_group {
+	hd44780_handle_t 			handle[HD44780_GROUP_MAX_PANEL];
+	uint32_t 					done_us[HD44780_GROUP_MAX_PANEL];	/* Completion time of each panel in last commit */
+	stm_err_t 					err[HD44780_GROUP_MAX_PANEL];
+	uint8_t 					num_handle;
+	hd44780_group_bus_t 		bus[HD44780_GROUP_MAX_PANEL];
+	uint8_t 					num_bus;
+	SemaphoreHandle_t 			done;								/* Given by each worker after its panels */
+	bool 						running;							/* Committed and not joined yet */
+	bool 						stop;
+} hd44780_group_t;
+#endif
+
+void _hd44780_cleanup(hd44780_handle_t handle)
+{
+#ifndef HD44780_SINGLE_OWNER
+	if (handle->lock) {
+		mutex_destroy(handle->lock);
+	}
+#endif
+
+	if (!handle->is_static) {
+		free(handle);
+	}
+}
+
+static bool _config_is_valid(hd44780_cfg_t *config)
+{
+	return config &&
+	       (config->size < HD44780_SIZE_MAX) &&
+	       (config->comm_mode < HD44780_COMM_MODE_MAX) &&
+	       (config->charset < HD44780_CHARSET_MAX) &&
+	       (!config->timing || _timing_is_valid(config->timing));
+}
+
+static hd44780_handle_t _hd44780_init(hd44780_handle_t handle, hd44780_cfg_t *config, uint8_t *fb)
+{
+	/* Make sure that RS pin not used in serial mode */
+	if (config->comm_mode == HD44780_COMM_MODE_SERIAL) {
+		config->hw_info.gpio_port_rw = -1;
+		config->hw_info.gpio_num_rw = -1;
+	}
+
+	/* Second controller of 40x4 LCD only differs by EN pin */
+	handle->size = config->size;
+	handle->num_ctrl = lcd_geometry[config->size].num_ctrl;
+	handle->ctrl[0].hw_info = config->hw_info;
+	if (handle->num_ctrl > 1) {
+		HD44780_CHECK(config->comm_mode != HD44780_COMM_MODE_SERIAL, INIT_ERR_STR, {_hd44780_cleanup(handle); return NULL;});
+		handle->ctrl[1].hw_info = config->hw_info;
+		handle->ctrl[1].hw_info.gpio_port_en = config->hw_info.gpio_port_en2;
+		handle->ctrl[1].hw_info.gpio_num_en = config->hw_info.gpio_num_en2;
+	}
+
+	/* Configure hw_infos */
+	if(!config->hw_info.is_init) {
+		init_func _init_func = _get_init_func(config->comm_mode);
+		for (uint8_t i = 0; i < handle->num_ctrl; i++) {
+			HD44780_CHECK(!_init_func(handle->ctrl[i].hw_info), INIT_ERR_STR, {_hd44780_cleanup(handle); return NULL;});
+		}
+	}
+
+	/* Update handle structure */
+	handle->comm_mode = config->comm_mode;
+	handle->_write_cmd = _get_write_cmd_func(config->comm_mode);
+	handle->_write_data = _get_write_data_func(config->comm_mode);
+	handle->_write_nibble = _get_write_nibble_func(config->comm_mode);
+	handle->_wait = _get_wait_func(config->hw_info);
+#ifndef HD44780_SINGLE_OWNER
+	handle->lock = mutex_create();
+	HD44780_CHECK(handle->lock, INIT_ERR_STR, {_hd44780_cleanup(handle); return NULL;});
+#endif
+	handle->charset = config->charset;
+	handle->get_time_us = config->get_time_us;
+	handle->timing = config->timing ? *config->timing : timing_default;
+	handle->cur = 0;
+	handle->display_on = true;
+	handle->backlight = LCD_BACKLIGHT;
+	handle->cgram_dirty = 0;
+	for (uint8_t i = 0; i < handle->num_ctrl; i++) {
+		handle->ctrl[i].addr = 0;
+		handle->ctrl[i].addr_cgram = false;
+		handle->ctrl[i].shift = 0;
+		handle->ctrl[i].ready_us = _get_time_us(handle);
+		handle->ctrl[i].shadow = &fb[2 * i * LCD_DDRAM_SIZE];
+		handle->ctrl[i].fb = &fb[(2 * i + 1) * LCD_DDRAM_SIZE];
+		memset(handle->ctrl[i].shadow, ' ', LCD_DDRAM_SIZE);
+		memset(handle->ctrl[i].fb, ' ', LCD_DDRAM_SIZE);
+	}
+
+	/* Same nibble reset as recovery, controller may be in any state */
+	vTaskDelay(LCD_POWER_ON_DELAY_MS / portTICK_PERIOD_MS);
+	HD44780_CHECK(!_resync(handle, true), INIT_ERR_STR, {_hd44780_cleanup(handle); return NULL;});
+
+	return handle;
+}
+
+hd44780_handle_t hd44780_init(hd44780_cfg_t *config)
+{
+	/* Check input condition */
+	HD44780_CHECK(_config_is_valid(config), INIT_ERR_STR, return NULL);
+
+	/* Frame buffer follows handle structure in the same allocation */
+	hd44780_handle_t handle = calloc(1, sizeof(hd44780_t) + HD44780_FB_SIZE(config->size));
+	HD44780_CHECK(handle, INIT_ERR_STR, return NULL);
+
+	return _hd44780_init(handle, config, (uint8_t *)(handle + 1));
+}
+
+hd44780_handle_t hd44780_init_static(hd44780_cfg_t *config, hd44780_static_t *storage, uint8_t *fb, uint32_t fb_size)
+{
+	/* Check input condition */
+	HD44780_CHECK(_config_is_valid(config), INIT_ERR_STR, return NULL);
+	HD44780_CHECK(storage, INIT_ERR_STR, return NULL);
+	HD44780_CHECK(fb, INIT_ERR_STR, return NULL);
+	HD44780_CHECK(fb_size >= HD44780_FB_SIZE(config->size), INIT_ERR_STR, return NULL);
+
+	hd44780_handle_t handle = (hd44780_handle_t)storage;
+	memset(handle, 0, sizeof(hd44780_t));
+	handle->is_static = true;
+
+	return _hd44780_init(handle, config, fb);
+}
+
+stm_err_t hd44780_clear(hd44780_handle_t handle)
+{
+	/* Check input condition */
+	HD44780_CHECK(handle, CLEAR_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	mutex_lock(handle->lock);
+
+	int ret = _send_cmd_all(handle, 0x01);
+	if (ret) {
+		STM_LOGE(TAG, CLEAR_ERR_STR);
+		mutex_unlock(handle->lock);
+		return STM_FAIL;
+	}
+
+	/* Fallback glyphs and page are no longer on screen */
+	_release_fallback_glyphs(handle);
+	handle->page = NULL;
+
+	mutex_unlock(handle->lock);
+
+	return STM_OK;
+}
+
+stm_err_t hd44780_home(hd44780_handle_t handle)
+{
+	/* Check input condition */
+	HD44780_CHECK(handle, HOME_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	mutex_lock(handle->lock);
+
+	int ret = _send_cmd_all(handle, 0x02);
+	if (ret) {
+		STM_LOGE(TAG, HOME_ERR_STR);
+		mutex_unlock(handle->lock);
+		return STM_FAIL;
+	}
+
+	mutex_unlock(handle->lock);
+
+	return STM_OK;
+}
+
+stm_err_t hd44780_write_char(hd44780_handle_t handle, uint8_t chr)
+{
+	/* Check input condition */
+	HD44780_CHECK(handle, WRITE_CHR_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	mutex_lock(handle->lock);
+
+	int ret = _send_data(handle, chr);
+	if (ret) {
+		STM_LOGE(TAG, WRITE_CHR_ERR_STR);
+		mutex_unlock(handle->lock);
+		return STM_FAIL;
+	}
+
+	mutex_unlock(handle->lock);
+
+	return STM_OK;
+}
+
+stm_err_t hd44780_write_string(hd44780_handle_t handle, uint8_t *str)
+{
+	/* Check input condition */
+	HD44780_CHECK(handle, WRITE_STR_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(str, WRITE_STR_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	mutex_lock(handle->lock);
+	int ret;
+
+	while (*str) {
+		ret = _send_data(handle, *str);
+		if (ret) {
+			STM_LOGE(TAG, WRITE_STR_ERR_STR);
+			mutex_unlock(handle->lock);
+			return STM_FAIL;
+		}
+		str++;
+	}
+	mutex_unlock(handle->lock);
+
+	return STM_OK;
+}
+
+stm_err_t hd44780_write_utf8(hd44780_handle_t handle, const char *str)
+{
+	/* Check input condition */
+	HD44780_CHECK(handle, WRITE_UTF8_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(str, WRITE_UTF8_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	mutex_lock(handle->lock);
+
+	const uint8_t *s = (const uint8_t *)str;
+	uint32_t cp;
+	uint8_t code;
+
+	while ((cp = hd44780_utf8_next(&s)) != 0) {
+		if (_map_char(handle, cp, &code) || _send_data(handle, code)) {
+			STM_LOGE(TAG, WRITE_UTF8_ERR_STR);
+			mutex_unlock(handle->lock);
+			return STM_FAIL;
+		}
+	}
+	mutex_unlock(handle->lock);
+
+	return STM_OK;
+}
+
+stm_err_t hd44780_write_int(hd44780_handle_t handle, int number)
+{
+	/* Check input condition */
+	HD44780_CHECK(handle, WRITE_INT_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	char buf[LCD_INT_TEXT_SIZE];
+	int len = snprintf(buf, sizeof(buf), "%d", number);
+
+	mutex_lock(handle->lock);
+
+	for (int i = 0; i < len; i++) {
+		if (_send_data(handle, buf[i])) {
+			STM_LOGE(TAG, WRITE_INT_ERR_STR);
+			mutex_unlock(handle->lock);
+			return STM_FAIL;
+		}
+	}
+
+	mutex_unlock(handle->lock);
+
+	return STM_OK;
+}
+
+stm_err_t hd44780_write_float(hd44780_handle_t handle, float number, uint8_t precision)
+{
+	/* Check input condition */
+	HD44780_CHECK(handle, WRITE_FLOAT_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	/* Text beyond DDRAM size could not be shown anyway */
+	char buf[LCD_DDRAM_SIZE + 1];
+	snprintf(buf, sizeof(buf), "%.*f", precision, number);
+	int len = strlen(buf);
+
+	mutex_lock(handle->lock);
+
+	for (int i = 0; i < len; i++) {
+		if (_send_data(handle, buf[i])) {
+			STM_LOGE(TAG, WRITE_FLOAT_ERR_STR);
+			mutex_unlock(handle->lock);
+			return STM_FAIL;
+		}
+	}
+
+	mutex_unlock(handle->lock);
+
+	return STM_OK;
+}
+
+stm_err_t hd44780_gotoxy(hd44780_handle_t handle, uint8_t col, uint8_t row)
+{
+	/* Check input condition */
+	HD44780_CHECK(handle, GOTOXY_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(row < lcd_geometry[handle->size].rows, GOTOXY_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	mutex_lock(handle->lock);
+
+	handle->cur = lcd_geometry[handle->size].row_ctrl[row];
+	/* Visible position, like frame buffer writes */
+	int ret = _send_cmd(handle, 0x80 | _cell_addr(handle, col, row));
+	if (ret) {
+		STM_LOGE(TAG, GOTOXY_ERR_STR);
+		mutex_unlock(handle->lock);
+		return STM_FAIL;
+	}
+	mutex_unlock(handle->lock);
+
+	return STM_OK;
+}
+
+stm_err_t hd44780_shift_cursor_forward(hd44780_handle_t handle, uint8_t step)
+{
+	/* Check input condition */
+	HD44780_CHECK(handle, SHIFT_CURSOR_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	mutex_lock(handle->lock);
+	int ret;
+
+	for (uint8_t i = 0; i < step; i++) {
+		ret = _send_cmd(handle, 0x14);
+		if (ret) {
+			STM_LOGE(TAG, SHIFT_CURSOR_ERR_STR);
+			mutex_unlock(handle->lock);
+			return STM_FAIL;
+		}
+	}
+	mutex_unlock(handle->lock);
+
+	return STM_OK;
+}
+
+stm_err_t hd44780_shift_cursor_backward(hd44780_handle_t handle, uint8_t step)
+{
+	/* Check input condition */
+	HD44780_CHECK(handle, SHIFT_CURSOR_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	mutex_lock(handle->lock);
+	int ret;
+
+	for (uint8_t i = 0; i < step; i++) {
+		ret = _send_cmd(handle, 0x10);
+		if (ret) {
+			STM_LOGE(TAG, SHIFT_CURSOR_ERR_STR);
+			mutex_unlock(handle->lock);
+			return STM_FAIL;
+		}
+	}
+	mutex_unlock(handle->lock);
+
+	return STM_OK;
+}
+
+stm_err_t hd44780_set_charset(hd44780_handle_t handle, hd44780_charset_t charset)
+{
+	/* Check input condition */
+	HD44780_CHECK(handle, SET_CHARSET_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(charset < HD44780_CHARSET_MAX, SET_CHARSET_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	mutex_lock(handle->lock);
+	handle->charset = charset;
+	mutex_unlock(handle->lock);
+
+	return STM_OK;
+}
+
+static bool _slot_is_shared(hd44780_handle_t handle, uint8_t slot)
+{
+	/* Fallback and widget glyphs may be shown in any cell, overwriting them would change those cells */
+	return (handle->cgram_kind[slot] == CGRAM_KIND_FALLBACK) || (handle->cgram_kind[slot] == CGRAM_KIND_WIDGET);
+}
+
+stm_err_t hd44780_load_custom_char(hd44780_handle_t handle, uint8_t slot, const uint8_t *pattern)
+{
+	/* Check input condition */
+	HD44780_CHECK(handle, LOAD_CUSTOM_CHAR_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(slot < LCD_NUM_CGRAM_SLOT, LOAD_CUSTOM_CHAR_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(pattern, LOAD_CUSTOM_CHAR_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	mutex_lock(handle->lock);
+
+	int ret = _slot_is_shared(handle, slot) ? STM_FAIL : _load_cgram(handle, slot, pattern);
+	if (ret) {
+		STM_LOGE(TAG, LOAD_CUSTOM_CHAR_ERR_STR);
+		mutex_unlock(handle->lock);
+		return STM_FAIL;
+	}
+	handle->cgram_kind[slot] = CGRAM_KIND_USER;
+
+	mutex_unlock(handle->lock);
+
+	return STM_OK;
+}
+
+static stm_err_t _anim_send(hd44780_handle_t handle, const hd44780_animator_t *animator, uint8_t due)
+{
+	uint8_t batch[LCD_BATCH_SIZE];
+	uint8_t cur = handle->cur;
+	int ret = STM_OK;
+
+	/* Due slots of each controller go in one batch, adjacent slots share address instruction */
+	for (handle->cur = 0; !ret && (handle->cur < handle->num_ctrl); handle->cur++) {
+		hd44780_ctrl_t *ctrl = &handle->ctrl[handle->cur];
+		uint8_t addr = ctrl->addr;
+		bool addr_cgram = ctrl->addr_cgram;
+		int next = -1;
+
+		_batch_begin(handle, batch);
+		for (uint8_t slot = 0; !ret && (slot < HD44780_ANIM_MAX_SLOT); slot++) {
+			if (!(due & (1 << slot))) {
+				continue;
+			}
+
+			const uint8_t *pattern = &animator->anim[slot]->frames[animator->frame[slot] * 8];
+			if (slot != next) {
+				ret = _send_cmd(handle, 0x40 | (slot << 3));
+			}
+			for (uint8_t i = 0; !ret && (i < 8); i++) {
+				ret = _send_data(handle, pattern[i]);
+			}
+			next = slot + 1;
+		}
+
+		/* Restore address counter */
+		if (!ret) {
+			ret = _send_cmd(handle, (addr_cgram ? 0x40 : 0x80) | addr);
+		}
+		if (_batch_end(handle)) {
+			ret = STM_FAIL;
+		}
+	}
+	handle->cur = cur;
+
+	return ret;
+}
+
+stm_err_t hd44780_anim_start(hd44780_handle_t handle, hd44780_animator_t *animator, uint8_t slot, const hd44780_anim_t *anim)
+{
+	/* Check input condition */
+	HD44780_CHECK(handle && animator, ANIM_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(slot < HD44780_ANIM_MAX_SLOT, ANIM_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(anim && anim->frames && anim->num_frame && anim->ticks, ANIM_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	mutex_lock(handle->lock);
+
+	if (_slot_is_shared(handle, slot)) {
+		STM_LOGE(TAG, ANIM_ERR_STR);
+		mutex_unlock(handle->lock);
+		return STM_FAIL;
+	}
+
+	animator->anim[slot] = anim;
+	animator->frame[slot] = 0;
+	animator->count[slot] = 0;
+
+	int ret = _anim_send(handle, animator, 1 << slot);
+	if (ret) {
+		animator->anim[slot] = NULL;
+		STM_LOGE(TAG, ANIM_ERR_STR);
+		mutex_unlock(handle->lock);
+		return STM_FAIL;
+	}
+	handle->cgram_kind[slot] = CGRAM_KIND_ANIM;
+
+	mutex_unlock(handle->lock);
+
+	return STM_OK;
+}
+
+stm_err_t hd44780_anim_stop(hd44780_handle_t handle, hd44780_animator_t *animator, uint8_t slot)
+{
+	/* Check input condition */
+	HD44780_CHECK(handle && animator, ANIM_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(slot < HD44780_ANIM_MAX_SLOT, ANIM_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	mutex_lock(handle->lock);
+
+	/* Current frame stays as a custom character */
+	if (animator->anim[slot]) {
+		animator->anim[slot] = NULL;
+		handle->cgram_kind[slot] = CGRAM_KIND_USER;
+	}
+
+	mutex_unlock(handle->lock);
+
+	return STM_OK;
+}
+
+stm_err_t hd44780_anim_tick(hd44780_handle_t handle, hd44780_animator_t *animator)
+{
+	/* Check input condition */
+	HD44780_CHECK(handle && animator, ANIM_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	uint8_t due = 0;
+
+	mutex_lock(handle->lock);
+
+	for (uint8_t slot = 0; slot < HD44780_ANIM_MAX_SLOT; slot++) {
+		const hd44780_anim_t *anim = animator->anim[slot];
+		if (!anim || (++animator->count[slot] < anim->ticks)) {
+			continue;
+		}
+
+		animator->count[slot] = 0;
+		if (anim->num_frame > 1) {
+			animator->frame[slot] = (animator->frame[slot] + 1) % anim->num_frame;
+			due |= 1 << slot;
+		}
+	}
+
+	/* Every instance on screen follows its slot, DDRAM is not touched */
+	int ret = due ? _anim_send(handle, animator, due) : STM_OK;
+	if (ret) {
+		STM_LOGE(TAG, ANIM_ERR_STR);
+		mutex_unlock(handle->lock);
+		return STM_FAIL;
+	}
+
+	mutex_unlock(handle->lock);
+
+	return STM_OK;
+}
+
+stm_err_t hd44780_fb_write(hd44780_handle_t handle, uint8_t col, uint8_t row, const uint8_t *data, uint8_t len)
+{
+	/* Check input condition */
+	HD44780_CHECK(handle, FB_WRITE_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(data || !len, FB_WRITE_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(row < lcd_geometry[handle->size].rows, FB_WRITE_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	mutex_lock(handle->lock);
+
+	/* Clip at end of row */
+	for (uint8_t i = 0; (i < len) && (col + i < lcd_geometry[handle->size].cols); i++) {
+		_cell_ctrl(handle, row)->fb[_ddram_index(_cell_addr(handle, col + i, row))] = data[i];
+	}
+
+	mutex_unlock(handle->lock);
+
+	return STM_OK;
+}
+
+stm_err_t hd44780_flush(hd44780_handle_t handle)
+{
+	/* Check input condition */
+	HD44780_CHECK(handle, FLUSH_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	mutex_lock(handle->lock);
+
+	int ret = _flush(handle);
+	if (ret) {
+		STM_LOGE(TAG, FLUSH_ERR_STR);
+		mutex_unlock(handle->lock);
+		return STM_FAIL;
+	}
+
+	mutex_unlock(handle->lock);
+
+	return STM_OK;
+}
+
+stm_err_t hd44780_canvas_init(hd44780_canvas_t *canvas, uint8_t *buf, uint16_t width, uint16_t height)
+{
+	/* Check input condition */
+	HD44780_CHECK(canvas, VIEWPORT_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(buf, VIEWPORT_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(width && height, VIEWPORT_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	canvas->buf = buf;
+	canvas->width = width;
+	canvas->height = height;
+	memset(buf, ' ', (uint32_t)width * height);
+
+	return STM_OK;
+}
+
+stm_err_t hd44780_canvas_write(hd44780_canvas_t *canvas, uint16_t x, uint16_t y, const uint8_t *str)
+{
+	/* Check input condition */
+	HD44780_CHECK(canvas, VIEWPORT_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(str, VIEWPORT_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(y < canvas->height, VIEWPORT_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	uint8_t *line = &canvas->buf[(uint32_t)y * canvas->width];
+	while (*str && (x < canvas->width)) {
+		line[x++] = *str++;
+	}
+
+	return STM_OK;
+}
+
+stm_err_t hd44780_set_viewport(hd44780_handle_t handle, const hd44780_canvas_t *canvas, uint16_t x, uint16_t y)
+{
+	/* Check input condition */
+	HD44780_CHECK(handle, VIEWPORT_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(canvas && canvas->buf, VIEWPORT_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	mutex_lock(handle->lock);
+
+	uint8_t cols = lcd_geometry[handle->size].cols;
+	uint8_t rows = lcd_geometry[handle->size].rows;
+	uint8_t shift[LCD_MAX_CTRL];
+	uint8_t cur = handle->cur;
+
+	/*
+	 * Visible column 0 of the viewport is kept at DDRAM column x % 40, so one
+	 * column scroll is one display shift plus the column entering the view.
+	 */
+	uint8_t target = lcd_geometry[handle->size].hw_scroll ? (x % LCD_DDRAM_LINE_SIZE) : 0;
+
+	for (uint8_t i = 0; i < handle->num_ctrl; i++) {
+		shift[i] = handle->ctrl[i].shift;
+		handle->ctrl[i].shift = target;
+	}
+
+	for (uint8_t row = 0; row < rows; row++) {
+		const uint8_t *line = ((uint32_t)y + row < canvas->height) ? &canvas->buf[((uint32_t)y + row) * canvas->width] : NULL;
+		for (uint8_t col = 0; col < cols; col++) {
+			uint8_t chr = (line && ((uint32_t)x + col < canvas->width)) ? line[x + col] : ' ';
+			_cell_ctrl(handle, row)->fb[_ddram_index(_cell_addr(handle, col, row))] = chr;
+		}
+	}
+
+	/* Write cells before shifting so that entering column is already there */
+	for (uint8_t i = 0; i < handle->num_ctrl; i++) {
+		handle->ctrl[i].shift = shift[i];
+	}
+	int ret = _flush(handle);
+
+	for (handle->cur = 0; !ret && (handle->cur < handle->num_ctrl); handle->cur++) {
+		ret = _shift_display(handle, target);
+	}
+	handle->cur = cur;
+
+	if (ret) {
+		STM_LOGE(TAG, VIEWPORT_ERR_STR);
+		mutex_unlock(handle->lock);
+		return STM_FAIL;
+	}
+
+	mutex_unlock(handle->lock);
+
+	return STM_OK;
+}
+
+stm_err_t hd44780_field_init(hd44780_field_t *field, uint8_t *buf, uint8_t col, uint8_t row, uint8_t width)
+{
+	/* Check input condition */
+	HD44780_CHECK(field, FIELD_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(buf, FIELD_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(width && (width <= LCD_DDRAM_LINE_SIZE), FIELD_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	field->buf = buf;
+	field->col = col;
+	field->row = row;
+	field->width = width;
+	field->seq = 0;
+	field->rendered = UINT32_MAX;
+	field->next = NULL;
+	memset(buf, ' ', width);
+
+	return STM_OK;
+}
+
+stm_err_t hd44780_field_register(hd44780_handle_t handle, hd44780_field_t *field)
+{
+	/* Check input condition */
+	HD44780_CHECK(handle, FIELD_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(field && field->buf, FIELD_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(field->row < lcd_geometry[handle->size].rows, FIELD_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(field->col + field->width <= lcd_geometry[handle->size].cols, FIELD_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	mutex_lock(handle->lock);
+
+	/* Never equal to an even sequence, drawn on next render */
+	field->rendered = UINT32_MAX;
+	field->next = handle->fields;
+	handle->fields = field;
+
+	mutex_unlock(handle->lock);
+
+	return STM_OK;
+}
+
+stm_err_t hd44780_field_unregister(hd44780_handle_t handle, hd44780_field_t *field)
+{
+	/* Check input condition */
+	HD44780_CHECK(handle, FIELD_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(field, FIELD_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	mutex_lock(handle->lock);
+
+	hd44780_field_t **link = &handle->fields;
+	while (*link && (*link != field)) {
+		link = &(*link)->next;
+	}
+
+	if (*link == NULL) {
+		STM_LOGE(TAG, FIELD_ERR_STR);
+		mutex_unlock(handle->lock);
+		return STM_ERR_INVALID_ARG;
+	}
+	*link = field->next;
+	field->next = NULL;
+
+	mutex_unlock(handle->lock);
+
+	return STM_OK;
+}
+
+stm_err_t hd44780_field_publish(hd44780_field_t *field, const uint8_t *str)
+{
+	/* Check input condition */
+	HD44780_CHECK(field && field->buf, FIELD_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(str, FIELD_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	/* Sequence is odd while text is written, renderer retries meanwhile */
+	field->seq++;
+	__sync_synchronize();
+
+	uint8_t i = 0;
+	for (; (i < field->width) && str[i]; i++) {
+		field->buf[i] = str[i];
+	}
+	for (; i < field->width; i++) {
+		field->buf[i] = ' ';
+	}
+
+	__sync_synchronize();
+	field->seq++;
+
+	return STM_OK;
+}
+
+stm_err_t hd44780_field_render(hd44780_handle_t handle)
+{
+	/* Check input condition */
+	HD44780_CHECK(handle, FIELD_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	mutex_lock(handle->lock);
+
+	uint8_t text[LCD_DDRAM_LINE_SIZE];
+
+	for (hd44780_field_t *field = handle->fields; field; field = field->next) {
+		for (uint8_t retry = 0; retry < FIELD_READ_RETRY; retry++) {
+			uint32_t seq = field->seq;
+			if (seq == field->rendered) {
+				break;
+			}
+			if (seq & 1) {
+				continue;
+			}
+
+			__sync_synchronize();
+			memcpy(text, field->buf, field->width);
+			__sync_synchronize();
+
+			if (field->seq != seq) {
+				continue;
+			}
+
+			/* Consistent snapshot, staged in frame buffer */
+			for (uint8_t i = 0; i < field->width; i++) {
+				_cell_ctrl(handle, field->row)->fb[_ddram_index(_cell_addr(handle, field->col + i, field->row))] = text[i];
+			}
+			field->rendered = seq;
+			break;
+		}
+	}
+
+	int ret = _flush(handle);
+	if (ret) {
+		STM_LOGE(TAG, FIELD_ERR_STR);
+		mutex_unlock(handle->lock);
+		return STM_FAIL;
+	}
+
+	mutex_unlock(handle->lock);
+
+	return STM_OK;
+}
+
+static void _format_number(const hd44780_number_t *num, int32_t value, uint8_t *text)
+{
+	uint8_t digit[12];
+	uint8_t len = 0;
+	uint32_t mag = (value < 0) ? -(uint32_t)value : (uint32_t)value;
+
+	/* Digits in reverse order, at least one before decimal point */
+	do {
+		if (num->precision && (len == num->precision)) {
+			digit[len++] = '.';
+		}
+		digit[len++] = '0' + (mag % 10);
+		mag /= 10;
+	} while ((mag || (len <= num->precision)) && (len < sizeof(digit) - 1));
+
+	if (value < 0) {
+		digit[len++] = '-';
+	}
+
+	/* Value does not fit, make it obvious instead of showing wrong digits */
+	if (mag || (len > num->width)) {
+		memset(text, '#', num->width);
+		return;
+	}
+
+	uint8_t pad = num->width - len;
+	uint8_t start = (num->align == HD44780_ALIGN_LEFT) ? 0 : pad;
+
+	memset(text, ' ', num->width);
+	for (uint8_t i = 0; i < len; i++) {
+		text[start + i] = digit[len - 1 - i];
+	}
+}
+
+static bool _number_is_valid(hd44780_handle_t handle, const hd44780_number_t *num)
+{
+	return handle && num &&
+	       (num->align < HD44780_ALIGN_MAX) &&
+	       (num->precision < 10) &&
+	       (num->row < lcd_geometry[handle->size].rows) &&
+	       num->width && (num->col + num->width <= lcd_geometry[handle->size].cols);
+}
+
+static stm_err_t _number_show(hd44780_handle_t handle, const hd44780_number_t *num, const uint8_t *text)
+{
+	mutex_lock(handle->lock);
+
+	/* Shadow DDRAM holds what was rendered, only changed digits are sent */
+	for (uint8_t i = 0; i < num->width; i++) {
+		_cell_ctrl(handle, num->row)->fb[_ddram_index(_cell_addr(handle, num->col + i, num->row))] = text[i];
+	}
+
+	int ret = _flush_row(handle, num->col, num->row, num->width);
+	if (ret) {
+		STM_LOGE(TAG, NUMBER_ERR_STR);
+		mutex_unlock(handle->lock);
+		return STM_FAIL;
+	}
+
+	mutex_unlock(handle->lock);
+
+	return STM_OK;
+}
+
+stm_err_t hd44780_number_write(hd44780_handle_t handle, const hd44780_number_t *num, int32_t value)
+{
+	/* Check input condition */
+	HD44780_CHECK(_number_is_valid(handle, num), NUMBER_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	uint8_t text[LCD_DDRAM_LINE_SIZE];
+	_format_number(num, value, text);
+
+	return _number_show(handle, num, text);
+}
+
+stm_err_t hd44780_number_write_float(hd44780_handle_t handle, const hd44780_number_t *num, float value)
+{
+	/* Check input condition */
+	HD44780_CHECK(_number_is_valid(handle, num), NUMBER_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	float scaled = value;
+	for (uint8_t i = 0; i < num->precision; i++) {
+		scaled *= 10;
+	}
+	scaled += (scaled < 0) ? -0.5f : 0.5f;
+
+	/* Out of range and NaN are shown as overflow */
+	uint8_t text[LCD_DDRAM_LINE_SIZE];
+	if ((scaled > -2147483520.0f) && (scaled < 2147483520.0f)) {
+		_format_number(num, (int32_t)scaled, text);
+	} else {
+		memset(text, '#', num->width);
+	}
+
+	return _number_show(handle, num, text);
+}
+
+stm_err_t hd44780_page_init(hd44780_handle_t handle, hd44780_page_t *page, uint8_t *buf, uint32_t buf_size)
+{
+	/* Check input condition */
+	HD44780_CHECK(handle, PAGE_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(page, PAGE_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(buf, PAGE_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(buf_size >= HD44780_PAGE_SIZE(handle->size), PAGE_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	page->buf = buf;
+	page->cols = lcd_geometry[handle->size].cols;
+	page->rows = lcd_geometry[handle->size].rows;
+	memset(buf, ' ', page->cols * page->rows);
+
+	return STM_OK;
+}
+
+stm_err_t hd44780_page_write(hd44780_handle_t handle, hd44780_page_t *page, uint8_t col, uint8_t row, const uint8_t *str)
+{
+	/* Check input condition */
+	HD44780_CHECK(handle, PAGE_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(page && page->buf, PAGE_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(str, PAGE_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(row < page->rows, PAGE_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	mutex_lock(handle->lock);
+
+	uint8_t *line = &page->buf[row * page->cols];
+	uint8_t len = 0;
+	for (; str[len] && (col + len < page->cols); len++) {
+		line[col + len] = str[len];
+	}
+
+	/* Hidden pages only change in RAM */
+	if (handle->page != page) {
+		mutex_unlock(handle->lock);
+		return STM_OK;
+	}
+
+	for (uint8_t i = 0; i < len; i++) {
+		_cell_ctrl(handle, row)->fb[_ddram_index(_cell_addr(handle, col + i, row))] = line[col + i];
+	}
+
+	int ret = _flush_row(handle, col, row, len);
+	if (ret) {
+		STM_LOGE(TAG, PAGE_ERR_STR);
+		mutex_unlock(handle->lock);
+		return STM_FAIL;
+	}
+
+	mutex_unlock(handle->lock);
+
+	return STM_OK;
+}
+
+stm_err_t hd44780_page_show(hd44780_handle_t handle, const hd44780_page_t *page)
+{
+	/* Check input condition */
+	HD44780_CHECK(handle, PAGE_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(page && page->buf, PAGE_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK((page->cols == lcd_geometry[handle->size].cols) && (page->rows == lcd_geometry[handle->size].rows), PAGE_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	mutex_lock(handle->lock);
+
+	/* No clear, only cells differing between old and new page are sent */
+	for (uint8_t row = 0; row < page->rows; row++) {
+		for (uint8_t col = 0; col < page->cols; col++) {
+			_cell_ctrl(handle, row)->fb[_ddram_index(_cell_addr(handle, col, row))] = page->buf[row * page->cols + col];
+		}
+	}
+	handle->page = page;
+
+	int ret = _flush(handle);
+	if (ret) {
+		STM_LOGE(TAG, PAGE_ERR_STR);
+		mutex_unlock(handle->lock);
+		return STM_FAIL;
+	}
+
+	mutex_unlock(handle->lock);
+
+	return STM_OK;
+}
+
+static bool _template_is_valid(hd44780_handle_t handle, const hd44780_template_t *tpl)
+{
+	if (tpl->size != handle->size) {
+		return false;
+	}
+
+	for (uint16_t i = 0; i < tpl->num_run; i++) {
+		const hd44780_template_run_t *run = &tpl->runs[i];
+		if ((run->row >= lcd_geometry[handle->size].rows) || (run->col + run->len > lcd_geometry[handle->size].cols)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static stm_err_t _template_send(hd44780_handle_t handle, const hd44780_template_t *tpl)
+{
+	uint8_t batch[LCD_BATCH_SIZE];
+	uint8_t cur = handle->cur;
+	int ret = STM_OK;
+
+	/* Runs are sent as they are, address counter carries on between adjacent runs */
+	_batch_begin(handle, batch);
+	for (uint16_t i = 0; !ret && (i < tpl->num_run); i++) {
+		const hd44780_template_run_t *run = &tpl->runs[i];
+
+		handle->cur = lcd_geometry[handle->size].row_ctrl[run->row];
+		for (uint8_t k = 0; !ret && (k < run->len); k++) {
+			int index = _ddram_index(_cell_addr(handle, run->col + k, run->row));
+			handle->ctrl[handle->cur].fb[index] = run->text[k];
+			ret = _flush_cell(handle, index);
+		}
+	}
+	handle->cur = cur;
+	if (_batch_end(handle)) {
+		ret = STM_FAIL;
+	}
+
+	return ret;
+}
+
+stm_err_t hd44780_template_apply(hd44780_handle_t handle, const hd44780_template_t *tpl, bool diff)
+{
+	/* Check input condition */
+	HD44780_CHECK(handle, TEMPLATE_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(tpl && (tpl->runs || !tpl->num_run), TEMPLATE_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(_template_is_valid(handle, tpl), TEMPLATE_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	mutex_lock(handle->lock);
 
 	int ret;
-	if (row == 0) {
-		ret = handle->_write_cmd(handle->hw_info, 0x80 + col);
-		if (ret) {
-			STM_LOGE(TAG, GOTOXY_ERR_STR);
-			mutex_unlock(handle->lock);
+	if (diff) {
+		/* Cells already showing template content are skipped by flush */
+		for (uint16_t i = 0; i < tpl->num_run; i++) {
+			const hd44780_template_run_t *run = &tpl->runs[i];
+			for (uint8_t k = 0; k < run->len; k++) {
+				_cell_ctrl(handle, run->row)->fb[_ddram_index(_cell_addr(handle, run->col + k, run->row))] = run->text[k];
+			}
+		}
+		ret = _flush(handle);
+	} else {
+		ret = _template_send(handle, tpl);
+	}
+	handle->page = NULL;
+
+	if (ret) {
+		STM_LOGE(TAG, TEMPLATE_ERR_STR);
+		mutex_unlock(handle->lock);
+		return STM_FAIL;
+	}
+
+	mutex_unlock(handle->lock);
+
+	return STM_OK;
+}
+
+static uint8_t *_cell_fb(hd44780_handle_t handle, uint8_t col, uint8_t row)
+{
+	return &_cell_ctrl(handle, row)->fb[_ddram_index(_cell_addr(handle, col, row))];
+}
+
+static void _console_newline(hd44780_handle_t handle, hd44780_console_t *console)
+{
+	uint8_t cols = lcd_geometry[handle->size].cols;
+	uint8_t rows = lcd_geometry[handle->size].rows;
+
+	console->col = 0;
+	if (console->row + 1 < rows) {
+		console->row++;
+		return;
+	}
+
+	/* Scroll in frame buffer, flush only sends cells whose character changes */
+	for (uint8_t row = 0; row + 1 < rows; row++) {
+		for (uint8_t col = 0; col < cols; col++) {
+			*_cell_fb(handle, col, row) = *_cell_fb(handle, col, row + 1);
+		}
+	}
+	for (uint8_t col = 0; col < cols; col++) {
+		*_cell_fb(handle, col, rows - 1) = ' ';
+	}
+}
+
+static void _console_put(hd44780_handle_t handle, hd44780_console_t *console, uint8_t chr)
+{
+	uint8_t cols = lcd_geometry[handle->size].cols;
+
+	if (chr == '\n') {
+		/* Older text does not show after a shorter line */
+		for (uint8_t col = console->col; col < cols; col++) {
+			*_cell_fb(handle, col, console->row) = ' ';
+		}
+		_console_newline(handle, console);
+	} else if (chr == '\r') {
+		console->col = 0;
+	} else if (chr == '\b') {
+		if (console->col) {
+			console->col--;
+		}
+	} else if (chr == '\t') {
+		console->col = (console->col / CONSOLE_TAB_SIZE + 1) * CONSOLE_TAB_SIZE;
+		if (console->col > cols) {
+			console->col = cols;
+		}
+	} else {
+		/* Wrap is deferred so that a full row followed by newline is one line */
+		if (console->col >= cols) {
+			_console_newline(handle, console);
+		}
+
+		/* Other control characters would show CGRAM glyphs */
+		*_cell_fb(handle, console->col, console->row) = (chr < ' ') ? HD44780_CHARSET_REPLACEMENT : chr;
+		console->col++;
+	}
+}
+
+stm_err_t hd44780_console_init(hd44780_console_t *console, uint8_t *buf, uint16_t size)
+{
+	/* Check input condition */
+	HD44780_CHECK(console, CONSOLE_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(buf, CONSOLE_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(size >= 2, CONSOLE_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	console->buf = buf;
+	console->size = size;
+	console->head = 0;
+	console->tail = 0;
+	console->dropped = 0;
+	console->col = 0;
+	console->row = 0;
+
+	return STM_OK;
+}
+
+stm_err_t hd44780_console_write(hd44780_console_t *console, const uint8_t *str, uint16_t len)
+{
+	/* Check input condition */
+	HD44780_CHECK(console && console->buf, CONSOLE_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(str, CONSOLE_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	uint16_t head = console->head;
+	uint16_t space = (console->tail + console->size - head - 1) % console->size;
+
+	/* Single producer, a write not fitting in ring buffer is dropped whole */
+	if (len > space) {
+		console->dropped += len;
+		return STM_OK;
+	}
+
+	for (uint16_t i = 0; i < len; i++) {
+		console->buf[head] = str[i];
+		head = (head + 1) % console->size;
+	}
+
+	__sync_synchronize();
+	console->head = head;
+
+	return STM_OK;
+}
+
+stm_err_t hd44780_console_render(hd44780_handle_t handle, hd44780_console_t *console)
+{
+	/* Check input condition */
+	HD44780_CHECK(handle, CONSOLE_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(console && console->buf, CONSOLE_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(console->row < lcd_geometry[handle->size].rows, CONSOLE_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	mutex_lock(handle->lock);
+
+	/* Everything queued is applied to frame buffer, then sent with one flush */
+	uint16_t head = console->head;
+	__sync_synchronize();
+	while (console->tail != head) {
+		_console_put(handle, console, console->buf[console->tail]);
+		console->tail = (console->tail + 1) % console->size;
+	}
+	handle->page = NULL;
+
+	int ret = _flush(handle);
+	if (ret) {
+		STM_LOGE(TAG, CONSOLE_ERR_STR);
+		mutex_unlock(handle->lock);
+		return STM_FAIL;
+	}
+
+	mutex_unlock(handle->lock);
+
+	return STM_OK;
+}
+
+static stm_err_t _widget_code(hd44780_handle_t handle, uint8_t glyph, uint8_t *code)
+{
+	if (glyph == WIDGET_GLYPH_BLANK) {
+		*code = ' ';
+		return STM_OK;
+	}
+	if ((glyph == WIDGET_GLYPH_FULL) && hd44780_charset_lookup(handle->charset, FULL_BLOCK_CP, code)) {
+		return STM_OK;
+	}
+
+	/* Glyphs are shared by all widgets, loaded once into a free slot */
+	int free_slot = -1;
+	for (uint8_t slot = 0; slot < LCD_NUM_CGRAM_SLOT; slot++) {
+		if ((handle->cgram_kind[slot] == CGRAM_KIND_WIDGET) && (handle->cgram_owner[slot] == glyph)) {
+			*code = slot;
+			return STM_OK;
+		}
+		if ((free_slot < 0) && (handle->cgram_kind[slot] == CGRAM_KIND_FREE)) {
+			free_slot = slot;
+		}
+	}
+
+	HD44780_CHECK(free_slot >= 0, WIDGET_ERR_STR, return STM_FAIL);
+	if (_load_cgram(handle, free_slot, widget_glyph[glyph])) {
+		return STM_FAIL;
+	}
+	handle->cgram_kind[free_slot] = CGRAM_KIND_WIDGET;
+	handle->cgram_owner[free_slot] = glyph;
+	*code = free_slot;
+
+	return STM_OK;
+}
+
+static stm_err_t _widget_preload(hd44780_handle_t handle, uint8_t first, uint8_t num)
+{
+	uint8_t code;
+
+	for (uint8_t glyph = first; glyph < first + num; glyph++) {
+		if (_widget_code(handle, glyph, &code)) {
 			return STM_FAIL;
 		}
 	}
-	else if (row == 1) {
-		ret = handle->_write_cmd(handle->hw_info, 0xC0 + col);
-		if (ret) {
-			STM_LOGE(TAG, GOTOXY_ERR_STR);
-			mutex_unlock(handle->lock);
-			return STM_FAIL;
+
+	return STM_OK;
+}
+
+stm_err_t hd44780_widget_preload(hd44780_handle_t handle, uint8_t widgets)
+{
+	/* Check input condition */
+	HD44780_CHECK(handle, WIDGET_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	mutex_lock(handle->lock);
+
+	int ret = _widget_preload(handle, WIDGET_GLYPH_FULL, 1);
+	if (!ret && (widgets & HD44780_WIDGET_HBAR)) {
+		ret = _widget_preload(handle, WIDGET_GLYPH_HBAR_1, 4);
+	}
+	if (!ret && (widgets & HD44780_WIDGET_VBAR)) {
+		ret = _widget_preload(handle, WIDGET_GLYPH_VBAR_1, 7);
+	}
+	if (!ret && (widgets & HD44780_WIDGET_BIG_NUMBER)) {
+		ret = _widget_preload(handle, WIDGET_GLYPH_BIG_LB, 1);
+		if (!ret) {
+			ret = _widget_preload(handle, WIDGET_GLYPH_BIG_UB, 2);
+		}
+	}
+
+	if (ret) {
+		STM_LOGE(TAG, WIDGET_ERR_STR);
+		mutex_unlock(handle->lock);
+		return STM_FAIL;
+	}
+
+	mutex_unlock(handle->lock);
+
+	return STM_OK;
+}
+
+stm_err_t hd44780_widget_release(hd44780_handle_t handle)
+{
+	/* Check input condition */
+	HD44780_CHECK(handle, WIDGET_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	mutex_lock(handle->lock);
+
+	for (uint8_t slot = 0; slot < LCD_NUM_CGRAM_SLOT; slot++) {
+		if (handle->cgram_kind[slot] == CGRAM_KIND_WIDGET) {
+			handle->cgram_kind[slot] = CGRAM_KIND_FREE;
+		}
+	}
+
+	mutex_unlock(handle->lock);
+
+	return STM_OK;
+}
+
+static bool _bar_is_valid(hd44780_handle_t handle, const hd44780_bar_t *bar)
+{
+	if ((bar->dir >= HD44780_BAR_MAX) || !bar->len || (bar->row >= lcd_geometry[handle->size].rows)) {
+		return false;
+	}
+
+	if (bar->dir == HD44780_BAR_HORIZONTAL) {
+		return bar->col + bar->len <= lcd_geometry[handle->size].cols;
+	}
+
+	return (bar->col < lcd_geometry[handle->size].cols) && (bar->len <= bar->row + 1);
+}
+
+stm_err_t hd44780_bar_write(hd44780_handle_t handle, const hd44780_bar_t *bar, uint32_t value, uint32_t max)
+{
+	/* Check input condition */
+	HD44780_CHECK(handle, WIDGET_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(bar && _bar_is_valid(handle, bar), WIDGET_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(max, WIDGET_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	bool horizontal = (bar->dir == HD44780_BAR_HORIZONTAL);
+	uint8_t cell_px = horizontal ? 5 : 8;
+	uint8_t first = horizontal ? WIDGET_GLYPH_HBAR_1 : WIDGET_GLYPH_VBAR_1;
+	uint32_t px = (uint64_t)((value < max) ? value : max) * bar->len * cell_px / max;
+	uint8_t code[LCD_DDRAM_LINE_SIZE];
+	int ret = STM_OK;
+
+	mutex_lock(handle->lock);
+
+	/* All glyphs are loaded before any cell changes, frame buffer is left untouched if slots run out */
+	for (uint8_t i = 0; !ret && (i < bar->len); i++) {
+		uint32_t fill = (px > i * cell_px) ? px - i * cell_px : 0;
+		uint8_t glyph = (fill >= cell_px) ? WIDGET_GLYPH_FULL : fill ? first + fill - 1 : WIDGET_GLYPH_BLANK;
+
+		ret = _widget_code(handle, glyph, &code[i]);
+	}
+
+	/* Frame buffer is updated first, flush only sends cells whose glyph changes */
+	for (uint8_t i = 0; !ret && (i < bar->len); i++) {
+		if (horizontal) {
+			*_cell_fb(handle, bar->col + i, bar->row) = code[i];
+		} else {
+			*_cell_fb(handle, bar->col, bar->row - i) = code[i];
+			ret = _flush_row(handle, bar->col, bar->row - i, 1);
+		}
+	}
+	if (!ret && horizontal) {
+		ret = _flush_row(handle, bar->col, bar->row, bar->len);
+	}
+
+	if (ret) {
+		STM_LOGE(TAG, WIDGET_ERR_STR);
+		mutex_unlock(handle->lock);
+		return STM_FAIL;
+	}
+
+	mutex_unlock(handle->lock);
+
+	return STM_OK;
+}
+
+stm_err_t hd44780_big_number_write(hd44780_handle_t handle, const hd44780_number_t *num, int32_t value)
+{
+	/* Check input condition */
+	HD44780_CHECK(handle && num, WIDGET_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK((num->align < HD44780_ALIGN_MAX) && !num->precision && num->width, WIDGET_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(num->row + 1 < lcd_geometry[handle->size].rows, WIDGET_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(num->col + num->width * (BIG_CHAR_WIDTH + 1) - 1 <= lcd_geometry[handle->size].cols, WIDGET_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	uint8_t span = num->width * (BIG_CHAR_WIDTH + 1) - 1;
+	uint8_t text[LCD_DDRAM_LINE_SIZE];
+	uint8_t code[2][LCD_DDRAM_LINE_SIZE];
+	int ret = STM_OK;
+
+	_format_number(num, value, text);
+	memset(code, ' ', sizeof(code));
+
+	mutex_lock(handle->lock);
+
+	/* All glyphs are loaded before any cell changes, frame buffer is left untouched if slots run out */
+	for (uint8_t i = 0; !ret && (i < num->width); i++) {
+		uint8_t c = 0;
+		while ((big_char[c].chr != text[i]) && (big_char[c].chr != ' ')) {
+			c++;
+		}
+
+		for (uint8_t k = 0; !ret && (k < 2 * BIG_CHAR_WIDTH); k++) {
+			ret = _widget_code(handle, big_char[c].glyph[k], &code[k / BIG_CHAR_WIDTH][i * (BIG_CHAR_WIDTH + 1) + k % BIG_CHAR_WIDTH]);
+		}
+	}
+
+	for (uint8_t i = 0; !ret && (i < span); i++) {
+		*_cell_fb(handle, num->col + i, num->row) = code[0][i];
+		*_cell_fb(handle, num->col + i, num->row + 1) = code[1][i];
+	}
+
+	/* Only cells whose glyph changes are sent */
+	if (!ret) {
+		ret = _flush_row(handle, num->col, num->row, span);
+	}
+	if (!ret) {
+		ret = _flush_row(handle, num->col, num->row + 1, span);
+	}
+
+	if (ret) {
+		STM_LOGE(TAG, WIDGET_ERR_STR);
+		mutex_unlock(handle->lock);
+		return STM_FAIL;
+	}
+
+	mutex_unlock(handle->lock);
+
+	return STM_OK;
+}
+
+stm_err_t hd44780_resync(hd44780_handle_t handle)
+{
+	/* Check input condition */
+	HD44780_CHECK(handle, RESYNC_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	mutex_lock(handle->lock);
+
+	int ret = _resync(handle, false);
+	if (ret) {
+		STM_LOGE(TAG, RESYNC_ERR_STR);
+		mutex_unlock(handle->lock);
+		return STM_FAIL;
+	}
+
+	mutex_unlock(handle->lock);
+
+	return STM_OK;
+}
+
+stm_err_t hd44780_check_sync(hd44780_handle_t handle, bool *resynced)
+{
+	/* Check input condition */
+	HD44780_CHECK(handle, RESYNC_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(handle->comm_mode == HD44780_COMM_MODE_4BIT, RESYNC_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(handle->_wait == _wait_with_pinrw, RESYNC_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	mutex_lock(handle->lock);
+
+	uint8_t cur = handle->cur;
+	bool in_sync = true;
+
+	/* Mirrors run ahead of controller while display is off, checked after wake */
+	if (!handle->display_on) {
+		if (resynced) {
+			*resynced = false;
 		}
+		mutex_unlock(handle->lock);
+		return STM_OK;
 	}
-	else if (row == 2) {
-		ret = handle->_write_cmd(handle->hw_info, 0x94 + col);
-		if (ret) {
-			STM_LOGE(TAG, GOTOXY_ERR_STR);
-			mutex_unlock(handle->lock);
-			return STM_FAIL;
-		}
+
+	/* Address counter of each controller must match its mirror */
+	for (handle->cur = 0; in_sync && (handle->cur < handle->num_ctrl); handle->cur++) {
+		in_sync = _ac_is_in_sync(handle);
 	}
-	else {
-		ret = handle->_write_cmd(handle->hw_info, 0xD4 + col);
-		if (ret) {
-			STM_LOGE(TAG, GOTOXY_ERR_STR);
-			mutex_unlock(handle->lock);
-			return STM_FAIL;
-		}
+	handle->cur = cur;
+
+	if (resynced) {
+		*resynced = !in_sync;
+	}
+
+	if (!in_sync && _resync(handle, false)) {
+		STM_LOGE(TAG, RESYNC_ERR_STR);
+		mutex_unlock(handle->lock);
+		return STM_FAIL;
 	}
+
 	mutex_unlock(handle->lock);
 
 	return STM_OK;
 }
 
-stm_err_t hd44780_shift_cursor_forward(hd44780_handle_t handle, uint8_t step)
+stm_err_t hd44780_calibrate_timing(hd44780_handle_t handle, uint8_t margin_percent, hd44780_timing_t *timing)
 {
 	/* Check input condition */
-	HD44780_CHECK(handle, SHIFT_CURSOR_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(handle, CALIBRATE_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(handle->_wait == _wait_with_pinrw, CALIBRATE_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	/* RTOS tick is coarser than instruction execution, result would be the tick */
+	HD44780_CHECK(handle->get_time_us, CALIBRATE_ERR_STR, return STM_ERR_INVALID_ARG);
 
 	mutex_lock(handle->lock);
-	int ret;
 
-	for (uint8_t i = 0; i < step; i++) {
-		ret = handle->_write_cmd(handle->hw_info, 0x14);
-		if (ret) {
-			STM_LOGE(TAG, SHIFT_CURSOR_ERR_STR);
-			mutex_unlock(handle->lock);
-			return STM_FAIL;
+	hd44780_timing_t measure = {0};
+	uint8_t cur = handle->cur;
+	uint8_t addr[LCD_MAX_CTRL];
+	bool addr_cgram[LCD_MAX_CTRL];
+	int ret = STM_OK;
+
+	/* Nothing is sent while display is off */
+	if (!handle->display_on) {
+		STM_LOGE(TAG, CALIBRATE_ERR_STR);
+		mutex_unlock(handle->lock);
+		return STM_FAIL;
+	}
+
+	/* Controllers of 40x4 LCD may differ, slowest one sets each timing */
+	for (handle->cur = 0; !ret && (handle->cur < handle->num_ctrl); handle->cur++) {
+		addr[handle->cur] = handle->ctrl[handle->cur].addr;
+		addr_cgram[handle->cur] = handle->ctrl[handle->cur].addr_cgram;
+		ret = _calibrate_ctrl(handle, &measure);
+	}
+	handle->cur = cur;
+
+	/* Screen content and address counter of direct writes come back */
+	if (!ret) {
+		ret = _replay(handle, addr, addr_cgram, 0);
+	}
+	if (ret) {
+		STM_LOGE(TAG, CALIBRATE_ERR_STR);
+		mutex_unlock(handle->lock);
+		return STM_FAIL;
+	}
+
+	measure.clear_us += measure.clear_us * margin_percent / 100;
+	measure.home_us += measure.home_us * margin_percent / 100;
+	measure.cmd_us += measure.cmd_us * margin_percent / 100;
+	measure.data_us += measure.data_us * margin_percent / 100;
+
+	handle->timing = measure;
+	if (timing) {
+		*timing = measure;
+	}
+
+	mutex_unlock(handle->lock);
+
+	return STM_OK;
+}
+
+stm_err_t hd44780_plan_flush(hd44780_handle_t handle, hd44780_plan_t *plan)
+{
+	/* Check input condition */
+	HD44780_CHECK(handle, FLUSH_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(plan, FLUSH_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	mutex_lock(handle->lock);
+	_flush_plan(handle, plan, false);
+	mutex_unlock(handle->lock);
+
+	return STM_OK;
+}
+
+stm_err_t hd44780_set_cost(hd44780_handle_t handle, const hd44780_cost_t *cost)
+{
+	/* Check input condition */
+	HD44780_CHECK(handle, COST_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(!cost || (cost->cmd_us && cost->data_us), COST_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	mutex_lock(handle->lock);
+	if (cost) {
+		handle->cost = *cost;
+	} else {
+		memset(&handle->cost, 0, sizeof(hd44780_cost_t));
+	}
+	mutex_unlock(handle->lock);
+
+	return STM_OK;
+}
+
+stm_err_t hd44780_get_cost(hd44780_handle_t handle, hd44780_cost_t *cost)
+{
+	/* Check input condition */
+	HD44780_CHECK(handle, COST_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(cost, COST_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	mutex_lock(handle->lock);
+	_get_cost(handle, cost);
+	mutex_unlock(handle->lock);
+
+	return STM_OK;
+}
+
+stm_err_t hd44780_set_display(hd44780_handle_t handle, bool on)
+{
+	/* Check input condition */
+	HD44780_CHECK(handle, DISPLAY_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	mutex_lock(handle->lock);
+
+	int ret = STM_OK;
+	if (on && !handle->display_on) {
+		ret = _wake(handle);
+	} else if (!on && handle->display_on) {
+		ret = _send_display_ctrl(handle, false);
+		if (!ret) {
+			_save_lcd_state(handle);
+			handle->display_on = false;
 		}
 	}
+
+	if (ret) {
+		STM_LOGE(TAG, DISPLAY_ERR_STR);
+		mutex_unlock(handle->lock);
+		return STM_FAIL;
+	}
+
 	mutex_unlock(handle->lock);
 
 	return STM_OK;
 }
 
-stm_err_t hd44780_shift_cursor_backward(hd44780_handle_t handle, uint8_t step)
+stm_err_t hd44780_set_backlight(hd44780_handle_t handle, bool on)
 {
 	/* Check input condition */
-	HD44780_CHECK(handle, SHIFT_CURSOR_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(handle, BACKLIGHT_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(handle->comm_mode == HD44780_COMM_MODE_SERIAL, BACKLIGHT_ERR_STR, return STM_ERR_INVALID_ARG);
 
 	mutex_lock(handle->lock);
-	int ret;
 
-	for (uint8_t i = 0; i < step; i++) {
-		ret = handle->_write_cmd(handle->hw_info, 0x10);
-		if (ret) {
-			STM_LOGE(TAG, SHIFT_CURSOR_ERR_STR);
-			mutex_unlock(handle->lock);
-			return STM_FAIL;
+	/* Expander outputs are latched, a byte with EN low only changes backlight */
+	handle->backlight = on ? LCD_BACKLIGHT : 0;
+	int ret = _i2c_send(handle, &handle->backlight, 1);
+	if (ret) {
+		STM_LOGE(TAG, BACKLIGHT_ERR_STR);
+		mutex_unlock(handle->lock);
+		return STM_FAIL;
+	}
+
+	mutex_unlock(handle->lock);
+
+	return STM_OK;
+}
+
+stm_err_t hd44780_set_bus_hold(hd44780_handle_t handle, uint32_t max_us)
+{
+	/* Check input condition */
+	HD44780_CHECK(handle, BUS_HOLD_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(handle->comm_mode == HD44780_COMM_MODE_SERIAL, BUS_HOLD_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	mutex_lock(handle->lock);
+	handle->hold_max_us = max_us;
+	handle->hold_worst_us = 0;
+	mutex_unlock(handle->lock);
+
+	return STM_OK;
+}
+
+stm_err_t hd44780_get_bus_hold(hd44780_handle_t handle, uint32_t *worst_us)
+{
+	/* Check input condition */
+	HD44780_CHECK(handle, BUS_HOLD_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(worst_us, BUS_HOLD_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	mutex_lock(handle->lock);
+	*worst_us = handle->hold_worst_us;
+	mutex_unlock(handle->lock);
+
+	return STM_OK;
+}
+
+stm_err_t hd44780_set_timing(hd44780_handle_t handle, const hd44780_timing_t *timing)
+{
+	/* Check input condition */
+	HD44780_CHECK(handle, TIMING_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(timing, TIMING_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(_timing_is_valid(timing), TIMING_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	mutex_lock(handle->lock);
+	handle->timing = *timing;
+	mutex_unlock(handle->lock);
+
+	return STM_OK;
+}
+
+stm_err_t hd44780_get_timing(hd44780_handle_t handle, hd44780_timing_t *timing)
+{
+	/* Check input condition */
+	HD44780_CHECK(handle, TIMING_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(timing, TIMING_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	mutex_lock(handle->lock);
+	*timing = handle->timing;
+	mutex_unlock(handle->lock);
+
+	return STM_OK;
+}
+
+stm_err_t hd44780_trace_start(hd44780_handle_t handle, hd44780_trace_event_t *buf, uint32_t num_event)
+{
+	/* Check input condition */
+	HD44780_CHECK(handle, TRACE_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(buf, TRACE_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(num_event, TRACE_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	mutex_lock(handle->lock);
+	handle->trace_size = num_event;
+	handle->trace_head = 0;
+	handle->trace_count = 0;
+	handle->trace_dropped = 0;
+	handle->trace_buf = buf;
+	handle->trace_on = true;
+	mutex_unlock(handle->lock);
+
+	return STM_OK;
+}
+
+stm_err_t hd44780_trace_stop(hd44780_handle_t handle)
+{
+	/* Check input condition */
+	HD44780_CHECK(handle, TRACE_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	mutex_lock(handle->lock);
+	handle->trace_on = false;
+	mutex_unlock(handle->lock);
+
+	return STM_OK;
+}
+
+stm_err_t hd44780_trace_read(hd44780_handle_t handle, hd44780_trace_header_t *header, hd44780_trace_event_t *events, uint32_t max_event)
+{
+	/* Check input condition */
+	HD44780_CHECK(handle, TRACE_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(header, TRACE_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(events || !max_event, TRACE_ERR_STR, return STM_ERR_INVALID_ARG);
+
+	mutex_lock(handle->lock);
+
+	uint32_t num_event = (handle->trace_count < max_event) ? handle->trace_count : max_event;
+
+	/* Copy oldest events first and remove them from ring buffer */
+	if (handle->trace_size) {
+		uint32_t tail = (handle->trace_head + handle->trace_size - handle->trace_count) % handle->trace_size;
+		for (uint32_t i = 0; i < num_event; i++) {
+			events[i] = handle->trace_buf[(tail + i) % handle->trace_size];
 		}
 	}
+	handle->trace_count -= num_event;
+
+	header->magic = HD44780_TRACE_MAGIC;
+	header->version = HD44780_TRACE_VERSION;
+	header->size = handle->size;
+	header->comm_mode = handle->comm_mode;
+	header->reserved = 0;
+	header->num_event = num_event;
+	header->num_dropped = handle->trace_dropped;
+	handle->trace_dropped = 0;
+
 	mutex_unlock(handle->lock);
 
 	return STM_OK;
 }
 
+#ifndef HD44780_SINGLE_OWNER
+static bool _same_bus(hd44780_handle_t a, hd44780_handle_t b)
+{
+	/* Parallel LCDs have their own GPIOs, serial LCDs share I2C peripheral */
+	return (a->comm_mode == HD44780_COMM_MODE_SERIAL) &&
+	       (b->comm_mode == HD44780_COMM_MODE_SERIAL) &&
+	       (a->ctrl[0].hw_info.i2c_num == b->ctrl[0].hw_info.i2c_num);
+}
+
+static void _group_worker(void *arg)
+{
+	hd44780_group_bus_t *bus = (hd44780_group_bus_t *)arg;
+	hd44780_group_t *group = bus->group;
+
+	while (1) {
+		xSemaphoreTake(bus->start, portMAX_DELAY);
+		if (group->stop) {
+			break;
+		}
+
+		for (uint8_t i = 0; i < bus->num_panel; i++) {
+			uint8_t panel = bus->panel[i];
+			group->err[panel] = hd44780_flush(group->handle[panel]);
+			group->done_us[panel] = _get_time_us(group->handle[panel]);
+		}
+		xSemaphoreGive(group->done);
+	}
+
+	xSemaphoreGive(group->done);
+	vTaskDelete(NULL);
+}
+
+static void _group_cleanup(hd44780_group_t *group)
+{
+	/* Stop workers which were started */
+	group->stop = true;
+	for (uint8_t i = 0; i < group->num_bus; i++) {
+		if (group->bus[i].task) {
+			xSemaphoreGive(group->bus[i].start);
+			xSemaphoreTake(group->done, portMAX_DELAY);
+		}
+	}
+
+	for (uint8_t i = 0; i < group->num_bus; i++) {
+		if (group->bus[i].start) {
+			vQueueDelete(group->bus[i].start);
+		}
+	}
+	if (group->done) {
+		vQueueDelete(group->done);
+	}
+
+	free(group);
+}
+
+hd44780_group_handle_t hd44780_group_create(const hd44780_group_cfg_t *config)
+{
+	/* Check input condition */
+	HD44780_CHECK(config, GROUP_ERR_STR, return NULL);
+	HD44780_CHECK(config->handles, GROUP_ERR_STR, return NULL);
+	HD44780_CHECK(config->num_handle && (config->num_handle <= HD44780_GROUP_MAX_PANEL), GROUP_ERR_STR, return NULL);
+
+	hd44780_group_t *group = calloc(1, sizeof(hd44780_group_t));
+	HD44780_CHECK(group, GROUP_ERR_STR, return NULL);
+
+	/* One worker per bus, panels sharing a bus are flushed one after another */
+	for (uint8_t i = 0; i < config->num_handle; i++) {
+		hd44780_handle_t handle = config->handles[i];
+		HD44780_CHECK(handle, GROUP_ERR_STR, {_group_cleanup(group); return NULL;});
+
+		uint8_t b = 0;
+		while ((b < group->num_bus) && !_same_bus(group->handle[group->bus[b].panel[0]], handle)) {
+			b++;
+		}
+		if (b == group->num_bus) {
+			group->bus[b].group = group;
+			group->num_bus++;
+		}
+
+		group->handle[i] = handle;
+		group->bus[b].panel[group->bus[b].num_panel++] = i;
+	}
+	group->num_handle = config->num_handle;
+
+	uint16_t stack_size = config->stack_size ? config->stack_size : GROUP_TASK_STACK_SIZE;
+
+	group->done = xSemaphoreCreateCounting(group->num_bus, 0);
+	HD44780_CHECK(group->done, GROUP_ERR_STR, {_group_cleanup(group); return NULL;});
+
+	for (uint8_t b = 0; b < group->num_bus; b++) {
+		group->bus[b].start = xSemaphoreCreateBinary();
+		HD44780_CHECK(group->bus[b].start, GROUP_ERR_STR, {_group_cleanup(group); return NULL;});
+		HD44780_CHECK(xTaskCreate(_group_worker, "hd44780_group", stack_size, &group->bus[b], config->priority, &group->bus[b].task) == pdPASS,
+		              GROUP_ERR_STR, {group->bus[b].task = NULL; _group_cleanup(group); return NULL;});
+	}
+
+	return group;
+}
+
+stm_err_t hd44780_group_commit(hd44780_group_handle_t group)
+{
+	/* Check input condition */
+	HD44780_CHECK(group, GROUP_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(!group->running, GROUP_ERR_STR, return STM_FAIL);
+
+	/* Workers start within the same frame */
+	group->running = true;
+	for (uint8_t b = 0; b < group->num_bus; b++) {
+		xSemaphoreGive(group->bus[b].start);
+	}
+
+	return STM_OK;
+}
+
+stm_err_t hd44780_group_join(hd44780_group_handle_t group, uint32_t *done_us)
+{
+	/* Check input condition */
+	HD44780_CHECK(group, GROUP_ERR_STR, return STM_ERR_INVALID_ARG);
+	HD44780_CHECK(group->running, GROUP_ERR_STR, return STM_FAIL);
+
+	for (uint8_t b = 0; b < group->num_bus; b++) {
+		xSemaphoreTake(group->done, portMAX_DELAY);
+	}
+	group->running = false;
+
+	int ret = STM_OK;
+	for (uint8_t i = 0; i < group->num_handle; i++) {
+		if (group->err[i]) {
+			ret = STM_FAIL;
+		}
+		if (done_us) {
+			done_us[i] = group->done_us[i];
+		}
+	}
+
+	if (ret) {
+		STM_LOGE(TAG, GROUP_ERR_STR);
+	}
+
+	return ret;
+}
+
+void hd44780_group_destroy(hd44780_group_handle_t group)
+{
+	if (group == NULL) {
+		return;
+	}
+
+	if (group->running) {
+		hd44780_group_join(group, NULL);
+	}
+
+	_group_cleanup(group);
+}
+#endif
+
 void hd44780_destroy(hd44780_handle_t handle)
 {
+	if (handle == NULL) {
+		return;
+	}
+
 	_hd44780_cleanup(handle);
 }
\ No newline at end of file
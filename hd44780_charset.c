@@ -0,0 +1,130 @@
+#include "stddef.h"
+
+#include "include/hd44780_charset.h"
+
+typedef struct {
+	uint16_t 		cp;
+	uint8_t 		code;
+} hd44780_rom_entry_t;
+
+typedef struct {
+	uint16_t 		cp;
+	uint8_t 		pattern[8];
+} hd44780_glyph_entry_t;
+
+#include "hd44780_charset_table.h"
+
+#define UTF8_REPLACEMENT_CHAR		0xFFFD
+
+/*
+ * Perfect hash: code point selects a bucket, bucket seed selects a slot. Slot
+ * functions must match tools/gen_charset_table.py.
+ */
+static inline uint32_t _hash_bucket(uint32_t cp, uint8_t gbits)
+{
+	return (cp * 0x9E3779B1u) >> (32 - gbits);
+}
+
+static inline uint32_t _hash_slot(uint32_t cp, uint8_t seed, uint8_t bits)
+{
+	uint32_t h = (cp ^ (seed * 0x85EBCA6Bu)) * 0xC2B2AE35u;
+	h ^= h >> 15;
+	return (h * 0x27D4EB2Fu) >> (32 - bits);
+}
+
+static bool _rom_lookup(const hd44780_rom_entry_t *entry, const uint8_t *seed,
+                        uint8_t bits, uint8_t gbits, uint32_t cp, uint8_t *code)
+{
+	if (cp > 0xFFFF)
+		return false;
+
+	const hd44780_rom_entry_t *e = &entry[_hash_slot(cp, seed[_hash_bucket(cp, gbits)], bits)];
+	if (e->cp != cp)
+		return false;
+
+	*code = e->code;
+	return true;
+}
+
+uint32_t hd44780_utf8_next(const uint8_t **str)
+{
+	const uint8_t *s = *str;
+	uint32_t cp;
+	uint8_t len;
+
+	if (s[0] == 0)
+		return 0;
+
+	if (s[0] < 0x80) {
+		*str = s + 1;
+		return s[0];
+	} else if ((s[0] & 0xE0) == 0xC0) {
+		cp = s[0] & 0x1F;
+		len = 2;
+	} else if ((s[0] & 0xF0) == 0xE0) {
+		cp = s[0] & 0x0F;
+		len = 3;
+	} else if ((s[0] & 0xF8) == 0xF0) {
+		cp = s[0] & 0x07;
+		len = 4;
+	} else {
+		*str = s + 1;
+		return UTF8_REPLACEMENT_CHAR;
+	}
+
+	for (uint8_t i = 1; i < len; i++) {
+		if ((s[i] & 0xC0) != 0x80) {
+			*str = s + 1;
+			return UTF8_REPLACEMENT_CHAR;
+		}
+		cp = (cp << 6) | (s[i] & 0x3F);
+	}
+
+	/* Reject overlong encodings and surrogates */
+	if ((len == 2 && cp < 0x80) || (len == 3 && cp < 0x800) || (len == 4 && cp < 0x10000) ||
+	    (cp >= 0xD800 && cp <= 0xDFFF) || cp > 0x10FFFF) {
+		*str = s + 1;
+		return UTF8_REPLACEMENT_CHAR;
+	}
+
+	*str = s + len;
+	return cp;
+}
+
+bool hd44780_charset_lookup(hd44780_charset_t charset, uint32_t cp, uint8_t *code)
+{
+	if (charset == HD44780_CHARSET_A00) {
+		/* ASCII, except backslash and tilde which are Yen sign and right arrow */
+		if (cp >= 0x20 && cp <= 0x7D && cp != 0x5C) {
+			*code = cp;
+			return true;
+		}
+		/* Half-width katakana are in JIS X 0201 order */
+		if (cp >= 0xFF61 && cp <= 0xFF9F) {
+			*code = cp - 0xFF61 + 0xA1;
+			return true;
+		}
+		return _rom_lookup(rom_a00_entry, rom_a00_seed, ROM_A00_BITS, ROM_A00_GBITS, cp, code);
+	} else if (charset == HD44780_CHARSET_A02) {
+		/* ASCII and Latin-1 compatible upper half */
+		if ((cp >= 0x20 && cp <= 0x7E) || (cp >= 0xA0 && cp <= 0xFF)) {
+			*code = cp;
+			return true;
+		}
+		return _rom_lookup(rom_a02_entry, rom_a02_seed, ROM_A02_BITS, ROM_A02_GBITS, cp, code);
+	}
+
+	return false;
+}
+
+const uint8_t *hd44780_charset_glyph(uint32_t cp)
+{
+	if (cp == 0 || cp > 0xFFFF)
+		return NULL;
+
+	const hd44780_glyph_entry_t *e = &glyph_entry[_hash_slot(cp, glyph_seed[_hash_bucket(cp, GLYPH_GBITS)], GLYPH_BITS)];
+	if (e->cp != cp)
+		return NULL;
+
+	return e->pattern;
+}
@@ -0,0 +1,261 @@
+/* Generated by tools/gen_charset_table.py, do not edit. */
+
+#ifndef _HD44780_CHARSET_TABLE_H_
+#define _HD44780_CHARSET_TABLE_H_
+
+#define ROM_A00_BITS		7
+#define ROM_A00_GBITS		5
+
+static const uint8_t rom_a00_seed[32] = {
+	0, 29, 16, 0, 0, 7, 1, 1, 7, 0, 3, 30, 0, 15, 0, 3,
+	2, 2, 2, 1, 0, 8, 24, 24, 0, 0, 0, 3, 0, 0, 2, 0,
+};
+
+static const hd44780_rom_entry_t rom_a00_entry[128] = {
+	{0x30ED, 0xDB},
+	{0x30FC, 0xB0},
+	{0x30D2, 0xCB},
+	{0x00A5, 0x5C},
+	{0x300C, 0xA2},
+	{0x0000, 0x00},
+	{0x2588, 0xFF},
+	{0x30E9, 0xD7},
+	{0x0000, 0x00},
+	{0x0000, 0x00},
+	{0x0000, 0x00},
+	{0x0000, 0x00},
+	{0x30A3, 0xA8},
+	{0x0000, 0x00},
+	{0x30BD, 0xBF},
+	{0x30EC, 0xDA},
+	{0x30D5, 0xCC},
+	{0x0000, 0x00},
+	{0x0000, 0x00},
+	{0x0000, 0x00},
+	{0x3002, 0xA1},
+	{0x30B3, 0xBA},
+	{0x00F1, 0xEE},
+	{0x0000, 0x00},
+	{0x4E07, 0xFB},
+	{0x2192, 0x7E},
+	{0x30E4, 0xD4},
+	{0x0000, 0x00},
+	{0x30E7, 0xAE},
+	{0x03C1, 0xE6},
+	{0x0000, 0x00},
+	{0x0000, 0x00},
+	{0x30A2, 0xB1},
+	{0x30A1, 0xA7},
+	{0x30D8, 0xCD},
+	{0x30A9, 0xAB},
+	{0x221A, 0xE8},
+	{0x0000, 0x00},
+	{0x00B0, 0xDF},
+	{0x03B1, 0xE0},
+	{0x30B5, 0xBB},
+	{0x00A3, 0xED},
+	{0x00F6, 0xEF},
+	{0x30B9, 0xBD},
+	{0x30CF, 0xCA},
+	{0x30B1, 0xB9},
+	{0x03B5, 0xE3},
+	{0x30BB, 0xBE},
+	{0x30E8, 0xD6},
+	{0x30A5, 0xA9},
+	{0x30CC, 0xC7},
+	{0x30C1, 0xC1},
+	{0x30CA, 0xC5},
+	{0x30E2, 0xD3},
+	{0x0000, 0x00},
+	{0x30E6, 0xD5},
+	{0x30AD, 0xB7},
+	{0x30C4, 0xC2},
+	{0x00B7, 0xA5},
+	{0x0000, 0x00},
+	{0x0000, 0x00},
+	{0x00FC, 0xF5},
+	{0x30C6, 0xC3},
+	{0x30C3, 0xAF},
+	{0x0000, 0x00},
+	{0x309C, 0xDF},
+	{0x30E0, 0xD1},
+	{0x0000, 0x00},
+	{0x0000, 0x00},
+	{0x0000, 0x00},
+	{0x221E, 0xF3},
+	{0x30EB, 0xD9},
+	{0x3001, 0xA4},
+	{0x0000, 0x00},
+	{0x0000, 0x00},
+	{0x00E4, 0xE1},
+	{0x30B7, 0xBC},
+	{0x30DB, 0xCE},
+	{0x0000, 0x00},
+	{0x30EA, 0xD8},
+	{0x2126, 0xF4},
+	{0x30EF, 0xDC},
+	{0x30E1, 0xD2},
+	{0x30CD, 0xC8},
+	{0x0000, 0x00},
+	{0x30C8, 0xC4},
+	{0x0000, 0x00},
+	{0x03BC, 0xE4},
+	{0x0000, 0x00},
+	{0x00A2, 0xEC},
+	{0x30A4, 0xB2},
+	{0x30CE, 0xC9},
+	{0x30CB, 0xC6},
+	{0x30E3, 0xAC},
+	{0x00F7, 0xFD},
+	{0x30A7, 0xAA},
+	{0x0000, 0x00},
+	{0x5343, 0xFA},
+	{0x03B2, 0xE2},
+	{0x30DE, 0xCF},
+	{0x5186, 0xFC},
+	{0x30BF, 0xC0},
+	{0x00DF, 0xE2},
+	{0x30AA, 0xB5},
+	{0x0000, 0x00},
+	{0x03A3, 0xF6},
+	{0x30AF, 0xB8},
+	{0x0000, 0x00},
+	{0x30A8, 0xB4},
+	{0x30A6, 0xB3},
+	{0x30AB, 0xB6},
+	{0x0000, 0x00},
+	{0x0000, 0x00},
+	{0x30F3, 0xDD},
+	{0x0000, 0x00},
+	{0x30E5, 0xAD},
+	{0x00B5, 0xE4},
+	{0x300D, 0xA3},
+	{0x03A9, 0xF4},
+	{0x309B, 0xDE},
+	{0x03C3, 0xE5},
+	{0x2190, 0x7F},
+	{0x30DF, 0xD0},
+	{0x30F2, 0xA6},
+	{0x03C0, 0xF7},
+	{0x03B8, 0xF2},
+	{0x30FB, 0xA5},
+	{0x0000, 0x00},
+};
+
+#define ROM_A02_BITS		6
+#define ROM_A02_GBITS		4
+
+static const uint8_t rom_a02_seed[16] = {
+	1, 3, 5, 6, 0, 1, 3, 17, 0, 10, 1, 35, 1, 2, 16, 15,
+};
+
+static const hd44780_rom_entry_t rom_a02_entry[64] = {
+	{0x0000, 0x00},
+	{0x0398, 0x99},
+	{0x0427, 0x8A},
+	{0x266C, 0x96},
+	{0x0411, 0x80},
+	{0x0000, 0x00},
+	{0x201D, 0x13},
+	{0x0000, 0x00},
+	{0x2193, 0x19},
+	{0x2191, 0x18},
+	{0x0429, 0x8C},
+	{0x0000, 0x00},
+	{0x03B1, 0x90},
+	{0x0000, 0x00},
+	{0x0428, 0x8B},
+	{0x0000, 0x00},
+	{0x2190, 0x1B},
+	{0x2302, 0x7F},
+	{0x0417, 0x83},
+	{0x0000, 0x00},
+	{0x2265, 0x1D},
+	{0x2229, 0x9F},
+	{0x0000, 0x00},
+	{0x0418, 0x84},
+	{0x2264, 0x1C},
+	{0x03B4, 0x9B},
+	{0x0000, 0x00},
+	{0x21B5, 0x17},
+	{0x25CF, 0x16},
+	{0x0000, 0x00},
+	{0x0000, 0x00},
+	{0x042B, 0x8E},
+	{0x25B2, 0x1E},
+	{0x221E, 0x9C},
+	{0x2192, 0x1A},
+	{0x0000, 0x00},
+	{0x0000, 0x00},
+	{0x03A3, 0x94},
+	{0x0000, 0x00},
+	{0x0423, 0x88},
+	{0x2665, 0x9D},
+	{0x03A9, 0x9A},
+	{0x0426, 0x89},
+	{0x0000, 0x00},
+	{0x2126, 0x9A},
+	{0x041B, 0x86},
+	{0x03C4, 0x97},
+	{0x0414, 0x81},
+	{0x041F, 0x87},
+	{0x0419, 0x85},
+	{0x201C, 0x12},
+	{0x0000, 0x00},
+	{0x0416, 0x82},
+	{0x0393, 0x92},
+	{0x03C0, 0x93},
+	{0x042D, 0x8F},
+	{0x25BC, 0x1F},
+	{0x03C3, 0x95},
+	{0x042A, 0x8D},
+	{0x0000, 0x00},
+	{0x266A, 0x91},
+	{0x03B5, 0x9E},
+	{0x25B6, 0x10},
+	{0x25C0, 0x11},
+};
+
+#define GLYPH_BITS		5
+#define GLYPH_GBITS		3
+
+static const uint8_t glyph_seed[8] = {
+	0, 11, 4, 0, 0, 2, 1, 0,
+};
+
+static const hd44780_glyph_entry_t glyph_entry[32] = {
+	{0x0000, {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+	{0x00F8, {0x00, 0x01, 0x0E, 0x13, 0x15, 0x19, 0x0E, 0x10}},
+	{0x00E0, {0x08, 0x04, 0x0E, 0x01, 0x0F, 0x11, 0x0F, 0x00}},
+	{0x0000, {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+	{0x2191, {0x04, 0x0E, 0x15, 0x04, 0x04, 0x04, 0x04, 0x00}},
+	{0x00E6, {0x00, 0x00, 0x1A, 0x05, 0x0F, 0x14, 0x0F, 0x00}},
+	{0x00DC, {0x0A, 0x00, 0x11, 0x11, 0x11, 0x11, 0x0E, 0x00}},
+	{0x2665, {0x00, 0x0A, 0x1F, 0x1F, 0x0E, 0x04, 0x00, 0x00}},
+	{0x007E, {0x00, 0x00, 0x08, 0x15, 0x02, 0x00, 0x00, 0x00}},
+	{0x0000, {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+	{0x00EA, {0x04, 0x0A, 0x0E, 0x11, 0x1F, 0x10, 0x0E, 0x00}},
+	{0x005C, {0x00, 0x10, 0x08, 0x04, 0x02, 0x01, 0x00, 0x00}},
+	{0x00D6, {0x0A, 0x00, 0x0E, 0x11, 0x11, 0x11, 0x0E, 0x00}},
+	{0x0000, {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+	{0x0000, {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+	{0x20AC, {0x06, 0x09, 0x1C, 0x08, 0x1C, 0x09, 0x06, 0x00}},
+	{0x00B3, {0x0C, 0x02, 0x0C, 0x02, 0x0C, 0x00, 0x00, 0x00}},
+	{0x00D8, {0x01, 0x0E, 0x13, 0x15, 0x19, 0x0E, 0x10, 0x00}},
+	{0x00E2, {0x04, 0x0A, 0x0E, 0x01, 0x0F, 0x11, 0x0F, 0x00}},
+	{0x2193, {0x04, 0x04, 0x04, 0x04, 0x15, 0x0E, 0x04, 0x00}},
+	{0x00C4, {0x0A, 0x00, 0x0E, 0x11, 0x1F, 0x11, 0x11, 0x00}},
+	{0x0394, {0x00, 0x04, 0x04, 0x0A, 0x0A, 0x11, 0x1F, 0x00}},
+	{0x0000, {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+	{0x00C5, {0x04, 0x0A, 0x04, 0x0E, 0x11, 0x1F, 0x11, 0x00}},
+	{0x00B1, {0x04, 0x04, 0x1F, 0x04, 0x04, 0x00, 0x1F, 0x00}},
+	{0x00E8, {0x08, 0x04, 0x0E, 0x11, 0x1F, 0x10, 0x0E, 0x00}},
+	{0x00E5, {0x04, 0x0A, 0x04, 0x0E, 0x01, 0x0F, 0x11, 0x0F}},
+	{0x00B2, {0x0C, 0x02, 0x04, 0x08, 0x0E, 0x00, 0x00, 0x00}},
+	{0x00E7, {0x00, 0x0E, 0x10, 0x10, 0x11, 0x0E, 0x04, 0x0C}},
+	{0x2713, {0x00, 0x01, 0x03, 0x16, 0x1C, 0x08, 0x00, 0x00}},
+	{0x00E9, {0x02, 0x04, 0x0E, 0x11, 0x1F, 0x10, 0x0E, 0x00}},
+	{0x0000, {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+};
+
+#endif /* _HD44780_CHARSET_TABLE_H_ */
@@ -32,13 +32,19 @@ extern "C" {
 #include "stm_err.h"
 #include "driver/gpio.h"
 #include "driver/i2c.h"
+#include "hd44780_charset.h"
 
 typedef struct hd44780 *hd44780_handle_t;	/* LCD handle structure */
 
+typedef struct hd44780_group *hd44780_group_handle_t;	/* LCD group handle structure */
+
+typedef uint32_t (*hd44780_get_time_us_t)(void);	/* Microsecond time source */
+
 typedef enum {
 	HD44780_SIZE_16_2 = 0,						/*!< LCD size 16x2 */
 	HD44780_SIZE_16_4,							/*!< LCD size 16x4 */
 	HD44780_SIZE_20_4,							/*!< LCD size 20x4 */
+	HD44780_SIZE_40_4,							/*!< LCD size 40x4, two controllers sharing all pins but EN */
 	HD44780_SIZE_MAX,
 } hd44780_size_t;
 
@@ -76,19 +82,201 @@ typedef struct {
 	i2c_pins_pack_t		i2c_pins_pack;				/*!< I2C Pins Pack for serial mode */
 	uint32_t			i2c_speed;					/*!< I2C speed */
 	bool				is_init;					/*!< Is hardware init */
+	int					gpio_port_en2;				/*!< GPIO Port EN of second controller, 40x4 only */
+	int					gpio_num_en2;				/*!< GPIO Num EN of second controller, 40x4 only */
 } hd44780_hw_info_t;
 
+typedef struct {
+	uint32_t 			clear_us;					/*!< Clear display execution time */
+	uint32_t 			home_us;					/*!< Return home execution time */
+	uint32_t 			cmd_us;						/*!< Other instructions execution time */
+	uint32_t 			data_us;					/*!< Data write execution time */
+} hd44780_timing_t;
+
+typedef struct {
+	uint16_t 			txn_us;						/*!< Bus transaction overhead, serial start, address and stop */
+	uint16_t 			cmd_us;						/*!< Set DDRAM address instruction, transfer and execution */
+	uint16_t 			data_us;					/*!< Data write, transfer and execution */
+} hd44780_cost_t;
+
+typedef struct {
+	uint16_t 			num_txn;					/*!< Bus transactions */
+	uint16_t 			num_cmd;					/*!< Set DDRAM address instructions */
+	uint16_t 			num_data;					/*!< Data writes, bridged cells included */
+	uint16_t 			num_bridged;				/*!< Unchanged cells rewritten to keep address counter running */
+	uint32_t 			cost_us;					/*!< Estimated bus time */
+} hd44780_plan_t;
+
+#define HD44780_TRACE_MAGIC			0x52544448		/*!< "HDTR" in little endian */
+#define HD44780_TRACE_VERSION		1
+
+typedef enum {
+	HD44780_TRACE_CMD = 0,						/*!< Instruction written, value is instruction */
+	HD44780_TRACE_DATA,							/*!< Data written, value is data */
+	HD44780_TRACE_WAIT,							/*!< Waited for execution, value is pending instruction, 0 for data */
+} hd44780_trace_type_t;
+
+#define HD44780_TRACE_CTRL_1		0x80			/*!< Type flag, event addressed second controller of 40x4 LCD */
+
+typedef struct {
+	uint32_t 			timestamp_us;				/*!< Event start time */
+	uint16_t 			duration_us;				/*!< Transfer or wait duration, saturated at 65535 */
+	uint8_t 			type;						/*!< Event type, hd44780_trace_type_t */
+	uint8_t 			value;						/*!< Instruction or data byte */
+} hd44780_trace_event_t;
+
+typedef struct {
+	uint32_t 			magic;						/*!< HD44780_TRACE_MAGIC */
+	uint8_t 			version;					/*!< HD44780_TRACE_VERSION */
+	uint8_t 			size;						/*!< LCD size, hd44780_size_t */
+	uint8_t 			comm_mode;					/*!< LCD communicate mode, hd44780_comm_mode_t */
+	uint8_t 			reserved;
+	uint32_t 			num_event;					/*!< Number of events following header */
+	uint32_t 			num_dropped;				/*!< Events overwritten since last read */
+} hd44780_trace_header_t;
+
+typedef struct {
+	uint8_t 			*buf;						/*!< Characters, row after row */
+	uint16_t 			width;						/*!< Canvas width in characters */
+	uint16_t 			height;						/*!< Canvas height in characters */
+} hd44780_canvas_t;
+
+typedef enum {
+	HD44780_ALIGN_RIGHT = 0,					/*!< Pad with spaces on the left */
+	HD44780_ALIGN_LEFT,							/*!< Pad with spaces on the right */
+	HD44780_ALIGN_MAX,
+} hd44780_align_t;
+
+typedef struct {
+	uint8_t 			col;						/*!< Column of first character */
+	uint8_t 			row;						/*!< Row position */
+	uint8_t 			width;						/*!< Field width, value not fitting is shown as '#' */
+	hd44780_align_t 	align;						/*!< Alignment inside field */
+	uint8_t 			precision;					/*!< Digits after decimal point, up to 9 */
+} hd44780_number_t;
+
+#define HD44780_PAGE_SIZE(size)		((size) == HD44780_SIZE_16_2 ? 32 : (size) == HD44780_SIZE_16_4 ? 64 : (size) == HD44780_SIZE_20_4 ? 80 : 160)	/*!< Page buffer bytes needed by LCD size */
+
+typedef struct {
+	uint8_t 			*buf;						/*!< Page content, row after row */
+	uint8_t 			cols;						/*!< Columns of LCD */
+	uint8_t 			rows;						/*!< Rows of LCD */
+} hd44780_page_t;
+
+typedef struct {
+	uint8_t 			col;						/*!< Column of first character */
+	uint8_t 			row;						/*!< Row position */
+	uint8_t 			len;						/*!< Number of characters */
+	const char 			*text;						/*!< Character ROM codes */
+} hd44780_template_run_t;
+
+typedef struct {
+	const hd44780_template_run_t 	*runs;			/*!< Runs in send order */
+	uint16_t 						num_run;		/*!< Number of runs */
+	hd44780_size_t 					size;			/*!< LCD size the layout is made for */
+} hd44780_template_t;
+
+/*
+ * Screen template kept in flash. Text is given in character ROM codes, use
+ * tools/gen_template.py to translate an UTF-8 layout for a charset:
+ *
+ *     HD44780_TEMPLATE(main_screen, HD44780_SIZE_16_2,
+ *         HD44780_TEMPLATE_TEXT(0, 0, "Temp:      \xDF" "C"),
+ *         HD44780_TEMPLATE_TEXT(0, 1, "Hum:        %"));
+ */
+#define HD44780_TEMPLATE_TEXT(col, row, str)	{(col), (row), sizeof(str) - 1, (str)}	/*!< Run of a template, str is a string literal */
+#define HD44780_TEMPLATE(name, lcd_size, ...)															\
+	static const hd44780_template_run_t name##_runs[] = {__VA_ARGS__};									\
+	static const hd44780_template_t name = {name##_runs, sizeof(name##_runs) / sizeof(name##_runs[0]), (lcd_size)}
+
+typedef struct {
+	uint8_t 			*buf;						/*!< Ring buffer of characters waiting for render */
+	uint16_t 			size;						/*!< Ring buffer size, holds size - 1 characters */
+	volatile uint16_t 	head;						/*!< Next write position, writer only */
+	volatile uint16_t 	tail;						/*!< Next read position, renderer only */
+	uint32_t 			dropped;					/*!< Characters dropped because ring buffer was full */
+	uint8_t 			col;						/*!< Cursor column, renderer only */
+	uint8_t 			row;						/*!< Cursor row, renderer only */
+} hd44780_console_t;
+
+#define HD44780_WIDGET_HBAR			0x01		/*!< Horizontal bar graph, 5 pixels per cell */
+#define HD44780_WIDGET_VBAR			0x02		/*!< Vertical bar graph, 8 pixels per cell */
+#define HD44780_WIDGET_BIG_NUMBER	0x04		/*!< Big number, 3x2 cells per digit */
+
+typedef enum {
+	HD44780_BAR_HORIZONTAL = 0,					/*!< Fills from left to right */
+	HD44780_BAR_VERTICAL,						/*!< Fills from bottom to top */
+	HD44780_BAR_MAX,
+} hd44780_bar_dir_t;
+
+typedef struct {
+	uint8_t 			col;						/*!< Column of left cell */
+	uint8_t 			row;						/*!< Row of bottom cell */
+	uint8_t 			len;						/*!< Length in cells */
+	hd44780_bar_dir_t 	dir;						/*!< Direction */
+} hd44780_bar_t;
+
+#define HD44780_ANIM_MAX_SLOT		8			/*!< CGRAM slots, one animation each */
+
+typedef struct {
+	const uint8_t 		*frames;					/*!< Patterns of 8 bytes, one per frame */
+	uint8_t 			num_frame;					/*!< Number of frames */
+	uint8_t 			ticks;						/*!< Ticks per frame */
+} hd44780_anim_t;
+
+typedef struct {
+	const hd44780_anim_t 	*anim[HD44780_ANIM_MAX_SLOT];	/*!< Animation of each slot, NULL if none */
+	uint8_t 				frame[HD44780_ANIM_MAX_SLOT];	/*!< Frame shown */
+	uint8_t 				count[HD44780_ANIM_MAX_SLOT];	/*!< Ticks since frame was shown */
+} hd44780_animator_t;
+
+typedef struct hd44780_field {
+	uint8_t 				*buf;						/*!< Published text, width characters */
+	uint8_t 				col;						/*!< Column of first character */
+	uint8_t 				row;						/*!< Row position */
+	uint8_t 				width;						/*!< Field width in characters */
+	volatile uint32_t 		seq;						/*!< Odd while text is being published */
+	uint32_t 				rendered;					/*!< Sequence of text on LCD, renderer only */
+	struct hd44780_field 	*next;						/*!< Next registered field, renderer only */
+} hd44780_field_t;
+
 typedef struct {
 	hd44780_size_t 				size;			/*!< LCD size */
 	hd44780_comm_mode_t 		comm_mode;		/*!< LCD communicate mode */
 	hd44780_hw_info_t			hw_info;		/*!< LCD hardware information */
+	hd44780_charset_t 			charset;		/*!< LCD character ROM, used by hd44780_write_utf8 */
+	const hd44780_timing_t 		*timing;		/*!< Timing profile, NULL to use default. With RW pin, only decides if busy flag is polled */
+	hd44780_get_time_us_t 		get_time_us;	/*!< Microsecond time source, NULL to use RTOS tick */
 } hd44780_cfg_t;
 
+#define HD44780_GROUP_MAX_PANEL		8				/*!< LCDs in one group */
+
+typedef struct {
+	hd44780_handle_t 			*handles;		/*!< Member LCDs */
+	uint8_t 					num_handle;		/*!< Number of member LCDs */
+	uint8_t 					priority;		/*!< Priority of bus worker tasks */
+	uint16_t 					stack_size;		/*!< Stack of each bus worker task in words, 0 to use default */
+} hd44780_group_cfg_t;
+
+/*
+ * Define HD44780_SINGLE_OWNER when building the driver if only one task uses
+ * the LCD. Handle then has no mutex and API calls do not lock.
+ */
+#define HD44780_FB_SIZE(size)		(((size) == HD44780_SIZE_40_4 ? 2 : 1) * 160)	/*!< Frame buffer bytes needed by LCD size */
+#define HD44780_STATIC_SIZE			(400 + 24 * sizeof(void *))					/*!< Upper bound of handle structure bytes with room for ABI differences, checked at build time */
+
+typedef union {
+	uint8_t 			buf[HD44780_STATIC_SIZE];
+	void 				*align;
+} hd44780_static_t;
+
 /*
  * @brief   Initialize Liquid-Crystal Display (LCD).
  * @note:   This function only get I2C_NUM to handler communication, not
  *          configure I2C 's parameters. You have to self configure I2C before
  *          pass I2C into this function.
+ * @note:   40x4 LCD is only supported in 4bit and 8bit mode, RW pin is
+ *          shared by both controllers.
  * @param   config Struct pointer.
  * @return
  *      - LCD handle structure: Success.
@@ -96,8 +284,23 @@ typedef struct {
  */
 hd44780_handle_t hd44780_init(hd44780_cfg_t *config);
 
+/*
+ * @brief   Initialize LCD in caller provided storage, no heap is used.
+ * @note:   Storage and frame buffer must outlive the handle.
+ * @param   config Struct pointer.
+ * @param   storage Handle structure storage.
+ * @param   fb Frame buffer, at least HD44780_FB_SIZE(config->size) bytes.
+ * @param   fb_size Frame buffer size in bytes.
+ * @return
+ *      - LCD handle structure: Success.
+ *      - 0: Fail.
+ */
+hd44780_handle_t hd44780_init_static(hd44780_cfg_t *config, hd44780_static_t *storage, uint8_t *fb, uint32_t fb_size);
+
 /*
  * @brief   Clear LCD screen.
+ * @note:   Return without waiting for execution, only the next access to
+ *          LCD waits for the remaining execution time.
  * @param   handle Handle structure.
  * @return
  *      - STM_OK:   Success.
@@ -107,6 +310,8 @@ stm_err_t hd44780_clear(hd44780_handle_t handle);
 
 /*
  * @brief   Set LCD cursor to home.
+ * @note:   Return without waiting for execution, only the next access to
+ *          LCD waits for the remaining execution time.
  * @param   handle Handle structure.
  * @return
  *      - STM_OK:   Success.
@@ -134,6 +339,20 @@ stm_err_t hd44780_write_char(hd44780_handle_t handle, uint8_t chr);
  */
 stm_err_t hd44780_write_string(hd44780_handle_t handle, uint8_t *str);
 
+/*
+ * @brief   Display UTF-8 string.
+ * @note:   Characters are translated to the character ROM of the handle.
+ *          Characters not in ROM are loaded into a free CGRAM slot if a
+ *          fallback glyph exists, else displayed as '?'. Fallback slots are
+ *          released by hd44780_clear.
+ * @param   handle Handle structure.
+ * @param 	str UTF-8 string.
+ * @return
+ *      - STM_OK:   Success.
+ *      - Others: 	Fail.
+ */
+stm_err_t hd44780_write_utf8(hd44780_handle_t handle, const char *str);
+
 /*
  * @brief   Display integer.
  * @param   handle Handle structure.
@@ -157,6 +376,8 @@ stm_err_t hd44780_write_float(hd44780_handle_t handle, float number, uint8_t pre
 
 /*
  * @brief 	Move LCD's cursor to cordinate (x,y). 
+ * @note:   Position is on screen, display shift is taken into account
+ *          like hd44780_fb_write.
  * @param   col Column position.
  * @param 	row Row position.
  * @return
@@ -185,8 +406,626 @@ stm_err_t hd44780_shift_cursor_forward(hd44780_handle_t handle, uint8_t step);
  */
 stm_err_t hd44780_shift_cursor_backward(hd44780_handle_t handle, uint8_t step);
 
+/*
+ * @brief   Write characters to frame buffer without sending them to LCD.
+ * @note:   Characters are clipped at end of row. Direct writes such as
+ *          hd44780_write_string also update frame buffer.
+ * @param   handle Handle structure.
+ * @param   col Column position.
+ * @param   row Row position.
+ * @param   data Characters.
+ * @param   len Number of characters.
+ * @return
+ *      - STM_OK:   Success.
+ *      - Others: 	Fail.
+ */
+stm_err_t hd44780_fb_write(hd44780_handle_t handle, uint8_t col, uint8_t row, const uint8_t *data, uint8_t len);
+
+/*
+ * @brief   Send frame buffer cells which differ from LCD content.
+ * @param   handle Handle structure.
+ * @return
+ *      - STM_OK:   Success.
+ *      - Others: 	Fail.
+ */
+stm_err_t hd44780_flush(hd44780_handle_t handle);
+
+/*
+ * @brief   Plan next flush without sending it.
+ * @note:   Flush visits cells in address counter order starting where it
+ *          points, so 20x4 row 0 runs on into row 2 and 40x4 lines wrap
+ *          without instruction. A gap between changed cells is bridged by
+ *          rewriting unchanged cells when cheaper than a set DDRAM address
+ *          instruction. On serial bus, writes of one flush share I2C
+ *          transactions. Estimated cost can be checked against trace or
+ *          measured flush time.
+ * @param   handle Handle structure.
+ * @param   plan Planned writes and estimated cost.
+ * @return
+ *      - STM_OK:   Success.
+ *      - Others: 	Fail.
+ */
+stm_err_t hd44780_plan_flush(hd44780_handle_t handle, hd44780_plan_t *plan);
+
+/*
+ * @brief   Set cost model used to plan flush.
+ * @note:   Default model is derived from bus type, I2C speed and timing
+ *          profile. Measured costs of the target can be set instead.
+ * @param   handle Handle structure.
+ * @param   cost Cost model, NULL to use default.
+ * @return
+ *      - STM_OK:   Success.
+ *      - Others: 	Fail.
+ */
+stm_err_t hd44780_set_cost(hd44780_handle_t handle, const hd44780_cost_t *cost);
+
+/*
+ * @brief   Get cost model used to plan flush.
+ * @param   handle Handle structure.
+ * @param   cost Cost model.
+ * @return
+ *      - STM_OK:   Success.
+ *      - Others: 	Fail.
+ */
+stm_err_t hd44780_get_cost(hd44780_handle_t handle, hd44780_cost_t *cost);
+
+/*
+ * @brief   Turn display on or off.
+ * @note:   While display is off nothing is sent, writes, flushes and CGRAM
+ *          loads only update RAM state. Turning it on sends the differences
+ *          with LCD content, then display on instruction, so screen shows
+ *          complete content at once. Recovery still reaches controller.
+ * @param   handle Handle structure.
+ * @param   on Display on.
+ * @return
+ *      - STM_OK:   Success.
+ *      - Others: 	Fail.
+ */
+stm_err_t hd44780_set_display(hd44780_handle_t handle, bool on);
+
+/*
+ * @brief   Turn backlight on or off.
+ * @note:   Serial mode only, backlight is an output of I2C expander.
+ *          Backlight is on after init.
+ * @param   handle Handle structure.
+ * @param   on Backlight on.
+ * @return
+ *      - STM_OK:   Success.
+ *      - Others: 	Fail.
+ */
+stm_err_t hd44780_set_backlight(hd44780_handle_t handle, bool on);
+
+/*
+ * @brief   Set longest time LCD may hold I2C bus in one transfer.
+ * @note:   Serial output is split into chunks ending on nibble boundary
+ *          and bus is released between chunks. Shorter chunks cost start,
+ *          address and stop of more transfers. A chunk holds at least one
+ *          nibble. Measured worst case is reset.
+ * @note:   Between chunks the writer calls taskYIELD, which only lets tasks
+ *          of the same priority run. A lower priority task waiting for the
+ *          bus gets it only when the writer blocks, so give tasks sharing
+ *          the bus the writer's priority or pace LCD writes.
+ * @param   handle Handle structure.
+ * @param   max_us Maximum hold time in microseconds, 0 for no limit.
+ * @return
+ *      - STM_OK:   Success.
+ *      - Others: 	Fail.
+ */
+stm_err_t hd44780_set_bus_hold(hd44780_handle_t handle, uint32_t max_us);
+
+/*
+ * @brief   Get longest I2C transfer measured.
+ * @note:   Measured from time source around each transfer, it includes
+ *          waiting for the bus held by other devices. Without microsecond
+ *          time source RTOS ticks are counted, so each transfer reads as 0
+ *          or a whole number of tick periods.
+ * @param   handle Handle structure.
+ * @param   worst_us Worst hold time in microseconds.
+ * @return
+ *      - STM_OK:   Success.
+ *      - Others: 	Fail.
+ */
+stm_err_t hd44780_get_bus_hold(hd44780_handle_t handle, uint32_t *worst_us);
+
+/*
+ * @brief   Initialize canvas larger than LCD, filled with spaces.
+ * @param   canvas Canvas.
+ * @param   buf Buffer of width * height bytes.
+ * @param   width Canvas width.
+ * @param   height Canvas height.
+ * @return
+ *      - STM_OK:   Success.
+ *      - Others: 	Fail.
+ */
+stm_err_t hd44780_canvas_init(hd44780_canvas_t *canvas, uint8_t *buf, uint16_t width, uint16_t height);
+
+/*
+ * @brief   Write string to canvas, clipped at canvas width. Nothing is sent.
+ * @param   canvas Canvas.
+ * @param   x Column position.
+ * @param   y Row position.
+ * @param   str String.
+ * @return
+ *      - STM_OK:   Success.
+ *      - Others: 	Fail.
+ */
+stm_err_t hd44780_canvas_write(hd44780_canvas_t *canvas, uint16_t x, uint16_t y, const uint8_t *str);
+
+/*
+ * @brief   Show part of canvas starting at (x, y).
+ * @note:   Only cells whose content changes are sent. On 2 rows LCD,
+ *          horizontal scroll uses display shift, so one column step costs
+ *          one instruction plus the entering column. Display shift also
+ *          applies to hd44780_gotoxy addresses.
+ * @param   handle Handle structure.
+ * @param   canvas Canvas.
+ * @param   x Column of canvas shown at left of LCD.
+ * @param   y Row of canvas shown at top of LCD.
+ * @return
+ *      - STM_OK:   Success.
+ *      - Others: 	Fail.
+ */
+stm_err_t hd44780_set_viewport(hd44780_handle_t handle, const hd44780_canvas_t *canvas, uint16_t x, uint16_t y);
+
+/*
+ * @brief   Initialize field, filled with spaces.
+ * @param   field Field.
+ * @param   buf Buffer of width bytes.
+ * @param   col Column of first character.
+ * @param   row Row position.
+ * @param   width Field width.
+ * @return
+ *      - STM_OK:   Success.
+ *      - Others: 	Fail.
+ */
+stm_err_t hd44780_field_init(hd44780_field_t *field, uint8_t *buf, uint8_t col, uint8_t row, uint8_t width);
+
+/*
+ * @brief   Register field to be drawn by hd44780_field_render.
+ * @param   handle Handle structure.
+ * @param   field Field, must stay valid until unregistered.
+ * @return
+ *      - STM_OK:   Success.
+ *      - Others: 	Fail.
+ */
+stm_err_t hd44780_field_register(hd44780_handle_t handle, hd44780_field_t *field);
+
+/*
+ * @brief   Remove field from LCD handle. Its characters stay on screen.
+ * @param   handle Handle structure.
+ * @param   field Field.
+ * @return
+ *      - STM_OK:   Success.
+ *      - Others: 	Fail.
+ */
+stm_err_t hd44780_field_unregister(hd44780_handle_t handle, hd44780_field_t *field);
+
+/*
+ * @brief   Publish field text, padded with spaces or truncated to width.
+ * @note:   Wait-free, no lock is taken and nothing is sent. Each field must
+ *          have only one publishing task, any number of fields can be
+ *          published concurrently.
+ * @param   field Field.
+ * @param   str String.
+ * @return
+ *      - STM_OK:   Success.
+ *      - Others: 	Fail.
+ */
+stm_err_t hd44780_field_publish(hd44780_field_t *field, const uint8_t *str);
+
+/*
+ * @brief   Send changes of all registered fields in one frame buffer flush.
+ * @note:   Each field is read as a consistent snapshot. A field whose
+ *          publisher keeps writing during the read is drawn on next render.
+ * @param   handle Handle structure.
+ * @return
+ *      - STM_OK:   Success.
+ *      - Others: 	Fail.
+ */
+stm_err_t hd44780_field_render(hd44780_handle_t handle);
+
+/*
+ * @brief   Show fixed point number in fixed width field.
+ * @note:   Value is in units of the last shown digit, 1234 with precision 1
+ *          is shown as 123.4. Only characters differing from LCD content
+ *          are sent, usually one address instruction and one digit.
+ * @param   handle Handle structure.
+ * @param   num Number field format.
+ * @param   value Value.
+ * @return
+ *      - STM_OK:   Success.
+ *      - Others: 	Fail.
+ */
+stm_err_t hd44780_number_write(hd44780_handle_t handle, const hd44780_number_t *num, int32_t value);
+
+/*
+ * @brief   Show float rounded to precision in fixed width field.
+ * @note:   Only characters differing from LCD content are sent.
+ * @param   handle Handle structure.
+ * @param   num Number field format.
+ * @param   value Value.
+ * @return
+ *      - STM_OK:   Success.
+ *      - Others: 	Fail.
+ */
+stm_err_t hd44780_number_write_float(hd44780_handle_t handle, const hd44780_number_t *num, float value);
+
+/*
+ * @brief   Load CGRAM glyphs of widgets.
+ * @note:   Widgets share one glyph set, each glyph takes a CGRAM slot once
+ *          and stays loaded when LCD is cleared. Widgets also load missing
+ *          glyphs on first use, preload keeps later updates free of CGRAM
+ *          writes. Horizontal bar and big number fit together in the 8
+ *          slots, vertical bar needs 7 slots on its own. Full block comes
+ *          from character ROM A00 and takes one more slot with A02.
+ * @param   handle Handle structure.
+ * @param   widgets HD44780_WIDGET_* flags.
+ * @return
+ *      - STM_OK:   Success.
+ *      - Others: 	Not enough free CGRAM slots.
+ */
+stm_err_t hd44780_widget_preload(hd44780_handle_t handle, uint8_t widgets);
+
+/*
+ * @brief   Free CGRAM slots of widget glyphs.
+ * @note:   Call once widgets are no longer shown, cells still showing a
+ *          widget glyph change when its slot is reused. Widgets load
+ *          their glyphs again on next use.
+ * @param   handle Handle structure.
+ * @return
+ *      - STM_OK:   Success.
+ *      - Others: 	Fail.
+ */
+stm_err_t hd44780_widget_release(hd44780_handle_t handle);
+
+/*
+ * @brief   Show bar graph.
+ * @note:   Only cells whose glyph changes are sent, one pixel step
+ *          usually costs one data write. LCD is left unchanged if glyphs
+ *          do not fit in free CGRAM slots.
+ * @param   handle Handle structure.
+ * @param   bar Bar graph.
+ * @param   value Value, clamped to max.
+ * @param   max Value of a full bar.
+ * @return
+ *      - STM_OK:   Success.
+ *      - Others: 	Fail.
+ */
+stm_err_t hd44780_bar_write(hd44780_handle_t handle, const hd44780_bar_t *bar, uint32_t value, uint32_t max);
+
+/*
+ * @brief   Show integer with big digits.
+ * @note:   Each character takes 3 columns and rows row and row + 1, with a
+ *          blank column between characters, width is in characters.
+ *          Precision must be 0. Only cells whose glyph changes are sent.
+ *          LCD is left unchanged if glyphs do not fit in free CGRAM slots.
+ * @param   handle Handle structure.
+ * @param   num Number field.
+ * @param   value Value.
+ * @return
+ *      - STM_OK:   Success.
+ *      - Others: 	Fail.
+ */
+stm_err_t hd44780_big_number_write(hd44780_handle_t handle, const hd44780_number_t *num, int32_t value);
+
+/*
+ * @brief   Initialize page kept in RAM, filled with spaces.
+ * @param   handle Handle structure.
+ * @param   page Page.
+ * @param   buf Buffer, at least HD44780_PAGE_SIZE(size) bytes.
+ * @param   buf_size Buffer size in bytes.
+ * @return
+ *      - STM_OK:   Success.
+ *      - Others: 	Fail.
+ */
+stm_err_t hd44780_page_init(hd44780_handle_t handle, hd44780_page_t *page, uint8_t *buf, uint32_t buf_size);
+
+/*
+ * @brief   Write string to page, clipped at end of row.
+ * @note:   Hidden page is only updated in RAM. On shown page, characters
+ *          differing from LCD content are also sent.
+ * @param   handle Handle structure.
+ * @param   page Page.
+ * @param   col Column position.
+ * @param   row Row position.
+ * @param   str String.
+ * @return
+ *      - STM_OK:   Success.
+ *      - Others: 	Fail.
+ */
+stm_err_t hd44780_page_write(hd44780_handle_t handle, hd44780_page_t *page, uint8_t col, uint8_t row, const uint8_t *str);
+
+/*
+ * @brief   Show page.
+ * @note:   LCD is not cleared, only cells differing between current screen
+ *          and page are sent, so layout shared by pages costs nothing.
+ * @param   handle Handle structure.
+ * @param   page Page.
+ * @return
+ *      - STM_OK:   Success.
+ *      - Others: 	Fail.
+ */
+stm_err_t hd44780_page_show(hd44780_handle_t handle, const hd44780_page_t *page);
+
+/*
+ * @brief   Apply screen template.
+ * @note:   Template is read from flash, nothing is formatted or copied.
+ *          Cells outside the runs are left as they are. Without diff every
+ *          run is sent, with diff only cells differing from current screen
+ *          are sent. A run starting where the address counter points, as
+ *          the first run at (0, 0) right after hd44780_clear or a run
+ *          continuing the previous one in DDRAM, needs no instruction.
+ *          Any other run first sends a set DDRAM address instruction.
+ * @param   handle Handle structure.
+ * @param   tpl Template, made for LCD size of handle.
+ * @param   diff Only send cells which differ.
+ * @return
+ *      - STM_OK:   Success.
+ *      - Others: 	Fail.
+ */
+stm_err_t hd44780_template_apply(hd44780_handle_t handle, const hd44780_template_t *tpl, bool diff);
+
+/*
+ * @brief   Set character ROM used to translate UTF-8 strings.
+ * @param   handle Handle structure.
+ * @param   charset Character ROM.
+ * @return
+ *      - STM_OK:   Success.
+ *      - Others: 	Fail.
+ */
+stm_err_t hd44780_set_charset(hd44780_handle_t handle, hd44780_charset_t charset);
+
+/*
+ * @brief   Load custom character into CGRAM.
+ * @note:   Slot is reserved and never used for fallback glyphs. Display it
+ *          with hd44780_write_char(handle, slot). Fails if slot holds a
+ *          fallback or widget glyph, clear LCD or call
+ *          hd44780_widget_release first.
+ * @param   handle Handle structure.
+ * @param   slot CGRAM slot (0-7).
+ * @param   pattern 8 bytes pattern, top row first, 5 least significant bits.
+ * @return
+ *      - STM_OK:   Success.
+ *      - Others: 	Fail.
+ */
+stm_err_t hd44780_load_custom_char(hd44780_handle_t handle, uint8_t slot, const uint8_t *pattern);
+
+/*
+ * @brief   Start animation in CGRAM slot.
+ * @note:   First frame is loaded at once and slot is reserved like a
+ *          custom character. Display it with hd44780_write_char(handle, slot),
+ *          every instance on screen then animates. Animator must be zero
+ *          initialized and is used with one LCD only. Fails if slot holds
+ *          a fallback or widget glyph.
+ * @param   handle Handle structure.
+ * @param   animator Animator.
+ * @param   slot CGRAM slot (0-7).
+ * @param   anim Animation, kept by reference.
+ * @return
+ *      - STM_OK:   Success.
+ *      - Others: 	Fail.
+ */
+stm_err_t hd44780_anim_start(hd44780_handle_t handle, hd44780_animator_t *animator, uint8_t slot, const hd44780_anim_t *anim);
+
+/*
+ * @brief   Stop animation in CGRAM slot.
+ * @note:   Frame shown stays as custom character.
+ * @param   handle Handle structure.
+ * @param   animator Animator.
+ * @param   slot CGRAM slot (0-7).
+ * @return
+ *      - STM_OK:   Success.
+ *      - Others: 	Fail.
+ */
+stm_err_t hd44780_anim_stop(hd44780_handle_t handle, hd44780_animator_t *animator, uint8_t slot);
+
+/*
+ * @brief   Advance animations by one tick.
+ * @note:   Call it from one periodic task. Slots whose frame changes are
+ *          rewritten together, one batch on serial bus, and DDRAM is not
+ *          touched: cost of a frame is 8 data writes per slot whatever the
+ *          number of instances on screen.
+ * @param   handle Handle structure.
+ * @param   animator Animator.
+ * @return
+ *      - STM_OK:   Success.
+ *      - Others: 	Fail.
+ */
+stm_err_t hd44780_anim_tick(hd44780_handle_t handle, hd44780_animator_t *animator);
+
+/*
+ * @brief   Initialize console.
+ * @note:   Console uses the whole LCD, cursor starts at top left.
+ * @param   console Console.
+ * @param   buf Ring buffer.
+ * @param   size Ring buffer size.
+ * @return
+ *      - STM_OK:   Success.
+ *      - Others: 	Fail.
+ */
+stm_err_t hd44780_console_init(hd44780_console_t *console, uint8_t *buf, uint16_t size);
+
+/*
+ * @brief   Queue characters to console.
+ * @note:   No lock is taken and nothing is sent, one writing task per
+ *          console. A write not fitting in ring buffer is dropped whole and
+ *          its characters are counted.
+ * @param   console Console.
+ * @param   str Characters, '\n', '\r', '\b' and '\t' are handled, other
+ *              control characters are shown as '?'.
+ * @param   len Number of characters.
+ * @return
+ *      - STM_OK:   Success.
+ *      - Others: 	Fail.
+ */
+stm_err_t hd44780_console_write(hd44780_console_t *console, const uint8_t *str, uint16_t len);
+
+/*
+ * @brief   Render queued console characters.
+ * @note:   Lines wrap at LCD width and screen scrolls up when cursor
+ *          passes last row. '\n' blanks the rest of the line it ends.
+ *          Scrolling happens in frame buffer and all queued lines are sent
+ *          with one flush, so only cells whose character changes are sent
+ *          and bus cost is bounded by LCD size whatever the number of lines.
+ * @param   handle Handle structure.
+ * @param   console Console.
+ * @return
+ *      - STM_OK:   Success.
+ *      - Others: 	Fail.
+ */
+stm_err_t hd44780_console_render(hd44780_handle_t handle, hd44780_console_t *console);
+
+/*
+ * @brief   Bring controllers back in step and redraw screen.
+ * @note:   Nibble reset puts controller in a known state whatever half
+ *          byte it waits for, then CGRAM glyphs in use and frame buffer are
+ *          replayed and address counter is restored. Without RW pin there
+ *          is no readback, call it periodically to recover from glitches
+ *          on EN line.
+ * @param   handle Handle structure.
+ * @return
+ *      - STM_OK:   Success.
+ *      - Others: 	Fail.
+ */
+stm_err_t hd44780_resync(hd44780_handle_t handle);
+
+/*
+ * @brief   Check that controllers are in step, resync if not.
+ * @note:   Only available on 4bit bus with RW pin. Address counter read
+ *          with busy flag is compared with its mirror, mismatch or stuck
+ *          busy flag means a nibble was lost or added. Same check runs
+ *          automatically once every 32 writes.
+ * @param   handle Handle structure.
+ * @param   resynced Set to true if resync was needed, NULL if not needed.
+ * @return
+ *      - STM_OK:   Success.
+ *      - Others: 	Fail.
+ */
+stm_err_t hd44780_check_sync(hd44780_handle_t handle, bool *resynced);
+
+/*
+ * @brief   Measure instruction execution time using busy flag.
+ * @note:   Only available when RW pin and a microsecond time source are
+ *          used. Execution is timed from the end of the write, so bus
+ *          transfer is not included. Both controllers of 40x4 LCD are
+ *          measured and the slower one sets each timing. Screen content
+ *          is written back afterwards. Measured timing is applied to
+ *          handle and can be stored, then passed to hd44780_cfg_t or
+ *          hd44780_set_timing of LCD without RW pin.
+ * @param   handle Handle structure.
+ * @param   margin_percent Safety margin added to measured time.
+ * @param   timing Measured timing profile, NULL if not needed.
+ * @return
+ *      - STM_OK:   Success.
+ *      - Others: 	Fail.
+ */
+stm_err_t hd44780_calibrate_timing(hd44780_handle_t handle, uint8_t margin_percent, hd44780_timing_t *timing);
+
+/*
+ * @brief   Set timing profile used when RW pin is not used.
+ * @param   handle Handle structure.
+ * @param   timing Timing profile.
+ * @return
+ *      - STM_OK:   Success.
+ *      - Others: 	Fail.
+ */
+stm_err_t hd44780_set_timing(hd44780_handle_t handle, const hd44780_timing_t *timing);
+
+/*
+ * @brief   Get timing profile of handle.
+ * @param   handle Handle structure.
+ * @param   timing Timing profile.
+ * @return
+ *      - STM_OK:   Success.
+ *      - Others: 	Fail.
+ */
+stm_err_t hd44780_get_timing(hd44780_handle_t handle, hd44780_timing_t *timing);
+
+/*
+ * @brief   Start recording bus events into ring buffer.
+ * @note:   Oldest events are overwritten when buffer is full. Header and
+ *          events read by hd44780_trace_read, written back to back, are the
+ *          input of tools/hd44780_trace.c.
+ * @param   handle Handle structure.
+ * @param   buf Ring buffer.
+ * @param   num_event Ring buffer size in events.
+ * @return
+ *      - STM_OK:   Success.
+ *      - Others: 	Fail.
+ */
+stm_err_t hd44780_trace_start(hd44780_handle_t handle, hd44780_trace_event_t *buf, uint32_t num_event);
+
+/*
+ * @brief   Stop recording bus events. Recorded events can still be read.
+ * @param   handle Handle structure.
+ * @return
+ *      - STM_OK:   Success.
+ *      - Others: 	Fail.
+ */
+stm_err_t hd44780_trace_stop(hd44780_handle_t handle);
+
+/*
+ * @brief   Read and remove oldest recorded events.
+ * @param   handle Handle structure.
+ * @param   header Trace header, num_event is number of events read.
+ * @param   events Events buffer.
+ * @param   max_event Events buffer size in events.
+ * @return
+ *      - STM_OK:   Success.
+ *      - Others: 	Fail.
+ */
+stm_err_t hd44780_trace_read(hd44780_handle_t handle, hd44780_trace_header_t *header, hd44780_trace_event_t *events, uint32_t max_event);
+
+#ifndef HD44780_SINGLE_OWNER
+/*
+ * @brief   Create group of LCDs flushed concurrently.
+ * @note:   One worker task is created per bus. LCDs on the same I2C
+ *          peripheral share a worker, each parallel LCD has its own.
+ *          Not available with HD44780_SINGLE_OWNER, workers flush from
+ *          their own task. Worker stack defaults to 512 words, set
+ *          stack_size from the high water mark measured on the target.
+ * @param   config Group configuration.
+ * @return
+ *      - Group handle structure: Success.
+ *      - 0: Fail.
+ */
+hd44780_group_handle_t hd44780_group_create(const hd44780_group_cfg_t *config);
+
+/*
+ * @brief   Start flushing all LCDs of group.
+ * @note:   Returns without waiting, call hd44780_group_join before next
+ *          commit. Frame buffers can still be written meanwhile, each
+ *          LCD is locked while it is flushed.
+ * @param   group Group handle structure.
+ * @return
+ *      - STM_OK:   Success.
+ *      - Others: 	Fail.
+ */
+stm_err_t hd44780_group_commit(hd44780_group_handle_t group);
+
+/*
+ * @brief   Wait until all LCDs of last commit are flushed.
+ * @param   group Group handle structure.
+ * @param   done_us Completion time of each LCD from its time source, in
+ *          order of hd44780_group_cfg_t handles, NULL if not needed.
+ * @return
+ *      - STM_OK:   Success.
+ *      - Others: 	Flush of at least one LCD failed.
+ */
+stm_err_t hd44780_group_join(hd44780_group_handle_t group, uint32_t *done_us);
+
+/*
+ * @brief   Destroy group and stop its workers.
+ * @note:   Member LCDs are not destroyed.
+ * @param   group Group handle structure.
+ * @return	None.
+ */
+void hd44780_group_destroy(hd44780_group_handle_t group);
+#endif
+
 /*
  * @brief   Destroy LCD handle structure.
+ * @note:   Storage of handle initialized by hd44780_init_static is not freed.
  * @param   handle Handle structure.
  * @return	None.
  */
@@ -0,0 +1,78 @@
+// MIT License
+
+// Copyright (c) 2020 phonght32
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef _HD44780_CHARSET_H_
+#define _HD44780_CHARSET_H_
+
+#ifdef __cplusplus 
+extern "C" {
+#endif
+
+#include "stdint.h"
+#include "stdbool.h"
+
+#define HD44780_CHARSET_REPLACEMENT		'?'		/*!< ROM code used when a character can not be displayed */
+
+typedef enum {
+	HD44780_CHARSET_A00 = 0,					/*!< Character ROM A00 (Japanese standard font) */
+	HD44780_CHARSET_A02,						/*!< Character ROM A02 (European standard font) */
+	HD44780_CHARSET_MAX,
+} hd44780_charset_t;
+
+/*
+ * @brief   Decode next UTF-8 character and advance string pointer.
+ * @note:   Malformed sequences consume one byte and decode as U+FFFD.
+ * @param   str Pointer to string pointer.
+ * @return
+ *      - Unicode code point.
+ *      - 0: End of string.
+ */
+uint32_t hd44780_utf8_next(const uint8_t **str);
+
+/*
+ * @brief   Look up character ROM code of an Unicode code point.
+ * @note:   Constant time and allocation free, safe to call per character.
+ * @param   charset Character ROM of LCD.
+ * @param   cp Unicode code point.
+ * @param   code ROM code.
+ * @return
+ *      - true:  Character available in ROM.
+ *      - false: Character not available in ROM.
+ */
+bool hd44780_charset_lookup(hd44780_charset_t charset, uint32_t cp, uint8_t *code);
+
+/*
+ * @brief   Get 5x8 fallback glyph of an Unicode code point.
+ * @param   cp Unicode code point.
+ * @return
+ *      - Pointer to 8 bytes pattern: Glyph available.
+ *      - NULL: No glyph.
+ */
+const uint8_t *hd44780_charset_glyph(uint32_t cp);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _HD44780_CHARSET_H_ */
@@ -0,0 +1,440 @@
+/*
+ * Host stand-ins for stm-idf drivers and FreeRTOS. GPIO and I2C writes are
+ * decoded into virtual HD44780 controllers, see vlcd.h. Tasks are threads and
+ * time is a virtual microsecond clock, advanced by bus activity and delays.
+ */
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "driver/gpio.h"
+#include "driver/i2c.h"
+#include "vlcd.h"
+
+#define VLCD_NUM_PIN				8
+#define VLCD_CLEAR_US				1520
+#define VLCD_CMD_US					37
+#define VLCD_DATA_US				41
+#define VLCD_I2C_SPEED_DEFAULT		100000
+
+typedef struct {
+	UBaseType_t 		count;
+	UBaseType_t 		max_count;
+} vsem_t;
+
+vlcd_t vlcd_port[VLCD_NUM_PORT];
+vlcd_t vlcd_i2c[I2C_NUM_MAX];
+
+/* One lock for clock, buses and semaphores, tasks run as threads */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sem_cond = PTHREAD_COND_INITIALIZER;
+static uint32_t now_us;
+static bool pin[VLCD_NUM_PORT][VLCD_NUM_PIN];
+static uint8_t i2c_last[I2C_NUM_MAX];
+static uint32_t i2c_speed[I2C_NUM_MAX];
+
+int vlcd_ddram_index(uint8_t addr)
+{
+	if ((addr & 0x3F) >= 40) {
+		return -1;
+	}
+
+	return ((addr & 0x40) ? 40 : 0) + (addr & 0x3F);
+}
+
+static void _ac_step(vlcd_ctrl_t *ctrl, bool inc)
+{
+	if (ctrl->ac_cgram) {
+		ctrl->ac = (ctrl->ac + (inc ? 1 : 0x3F)) & 0x3F;
+	} else if (inc) {
+		ctrl->ac = (ctrl->ac == 0x27) ? 0x40 : (ctrl->ac == 0x67) ? 0x00 : ctrl->ac + 1;
+	} else {
+		ctrl->ac = (ctrl->ac == 0x40) ? 0x27 : (ctrl->ac == 0x00) ? 0x67 : ctrl->ac - 1;
+	}
+}
+
+static void _exec_cmd(vlcd_ctrl_t *ctrl, uint8_t cmd)
+{
+	uint32_t exec_us = ctrl->cmd_us;
+
+	ctrl->num_cmd++;
+	if (cmd & 0x80) {
+		ctrl->ac = cmd & 0x7F;
+		ctrl->ac_cgram = false;
+	} else if (cmd & 0x40) {
+		ctrl->ac = cmd & 0x3F;
+		ctrl->ac_cgram = true;
+	} else if (cmd & 0x20) {
+		ctrl->four_bit = !(cmd & 0x10);
+	} else if (cmd & 0x10) {
+		if (cmd & 0x08) {
+			/* Shift left brings next DDRAM column to visible column 0 */
+			ctrl->shift = (ctrl->shift + ((cmd & 0x04) ? 39 : 1)) % 40;
+		} else {
+			_ac_step(ctrl, cmd & 0x04);
+		}
+	} else if (cmd & 0x08) {
+		ctrl->display_on = cmd & 0x04;
+	} else if (cmd & 0x04) {
+		ctrl->inc = cmd & 0x02;
+	} else if (cmd & 0x02) {
+		ctrl->ac = 0;
+		ctrl->ac_cgram = false;
+		ctrl->shift = 0;
+		exec_us = ctrl->clear_us;
+	} else if (cmd & 0x01) {
+		memset(ctrl->ddram, ' ', sizeof(ctrl->ddram));
+		ctrl->ac = 0;
+		ctrl->ac_cgram = false;
+		ctrl->shift = 0;
+		ctrl->inc = true;
+		exec_us = ctrl->clear_us;
+	}
+
+	ctrl->busy_until = now_us + exec_us;
+}
+
+static void _exec_data(vlcd_ctrl_t *ctrl, uint8_t data)
+{
+	ctrl->num_data++;
+	if (ctrl->ac_cgram) {
+		ctrl->cgram[ctrl->ac & 0x3F] = data;
+	} else if (vlcd_ddram_index(ctrl->ac) >= 0) {
+		ctrl->ddram[vlcd_ddram_index(ctrl->ac)] = data;
+	}
+	_ac_step(ctrl, ctrl->inc);
+
+	ctrl->busy_until = now_us + ctrl->data_us;
+}
+
+static void _latch(vlcd_ctrl_t *ctrl, bool rs, uint8_t nibble)
+{
+	/* Controller ignores writes while busy, first nibble starts the write */
+	if (!ctrl->half && ((int32_t)(now_us - ctrl->busy_until) < 0)) {
+		ctrl->num_violation++;
+	}
+
+	uint8_t val;
+	if (!ctrl->four_bit) {
+		/* D0 to D3 are not wired, read as low */
+		val = nibble << 4;
+	} else if (!ctrl->half) {
+		ctrl->high = nibble;
+		ctrl->half = true;
+		return;
+	} else {
+		val = (ctrl->high << 4) | nibble;
+		ctrl->half = false;
+	}
+
+	ctrl->ac_old = ctrl->ac;
+	if (rs) {
+		_exec_data(ctrl, val);
+	} else {
+		_exec_cmd(ctrl, val);
+	}
+}
+
+static uint8_t _read_nibble(vlcd_ctrl_t *ctrl, bool rs)
+{
+	/* Both nibbles come from the value seen on first pulse */
+	if (!ctrl->half) {
+		bool busy = (int32_t)(now_us - ctrl->busy_until) < 0;
+		bool settled = (int32_t)(now_us - ctrl->busy_until) >= VLCD_TADD_US;
+
+		ctrl->num_read++;
+		if (rs) {
+			int index = vlcd_ddram_index(ctrl->ac);
+			ctrl->read_val = ctrl->ac_cgram ? ctrl->cgram[ctrl->ac & 0x3F] : (index >= 0) ? ctrl->ddram[index] : 0;
+		} else {
+			ctrl->read_val = (busy ? 0x80 : 0x00) | (settled ? ctrl->ac : ctrl->ac_old);
+		}
+	}
+
+	return (ctrl->four_bit && ctrl->half) ? ctrl->read_val & 0x0F : ctrl->read_val >> 4;
+}
+
+static void _en_edge(int port, int num, bool level)
+{
+	vlcd_ctrl_t *ctrl = &vlcd_port[port].ctrl[num == VLCD_PIN_EN2];
+	bool rs = pin[port][VLCD_PIN_RS];
+	uint8_t nibble = 0;
+
+	for (int i = 0; i < 4; i++) {
+		nibble |= pin[port][VLCD_PIN_D4 + i] << i;
+	}
+
+	if (pin[port][VLCD_PIN_RW]) {
+		if (level) {
+			uint8_t out = _read_nibble(ctrl, rs);
+			for (int i = 0; i < 4; i++) {
+				pin[port][VLCD_PIN_D4 + i] = (out >> i) & 0x01;
+			}
+		} else if (ctrl->four_bit) {
+			ctrl->half = !ctrl->half;
+		}
+	} else if (!level) {
+		_latch(ctrl, rs, nibble);
+	}
+}
+
+void vlcd_reset(void)
+{
+	pthread_mutex_lock(&lock);
+	memset(vlcd_port, 0, sizeof(vlcd_port));
+	memset(vlcd_i2c, 0, sizeof(vlcd_i2c));
+	memset(pin, 0, sizeof(pin));
+	memset(i2c_last, 0, sizeof(i2c_last));
+
+	/* Power on state, DDRAM holds garbage until cleared */
+	for (int i = 0; i < VLCD_NUM_PORT + I2C_NUM_MAX; i++) {
+		vlcd_t *vlcd = (i < VLCD_NUM_PORT) ? &vlcd_port[i] : &vlcd_i2c[i - VLCD_NUM_PORT];
+		for (int c = 0; c < 2; c++) {
+			memset(vlcd->ctrl[c].ddram, 0xFF, sizeof(vlcd->ctrl[c].ddram));
+			vlcd->ctrl[c].inc = true;
+			vlcd->ctrl[c].clear_us = VLCD_CLEAR_US;
+			vlcd->ctrl[c].cmd_us = VLCD_CMD_US;
+			vlcd->ctrl[c].data_us = VLCD_DATA_US;
+		}
+	}
+	pthread_mutex_unlock(&lock);
+}
+
+uint32_t vlcd_time_us(void)
+{
+	pthread_mutex_lock(&lock);
+	uint32_t t = now_us++;
+	pthread_mutex_unlock(&lock);
+
+	return t;
+}
+
+void vlcd_advance_us(uint32_t us)
+{
+	pthread_mutex_lock(&lock);
+	now_us += us;
+	pthread_mutex_unlock(&lock);
+}
+
+void vlcd_set_time_us(uint32_t us)
+{
+	pthread_mutex_lock(&lock);
+	now_us = us;
+	pthread_mutex_unlock(&lock);
+}
+
+void vlcd_glitch_en(int port, int ctrl)
+{
+	int num = ctrl ? VLCD_PIN_EN2 : VLCD_PIN_EN;
+
+	gpio_set_level(port, num, true);
+	gpio_set_level(port, num, false);
+}
+
+stm_err_t gpio_config(gpio_cfg_t *cfg)
+{
+	return ((cfg->gpio_port < VLCD_NUM_PORT) && (cfg->gpio_num < VLCD_NUM_PIN)) ? STM_OK : STM_FAIL;
+}
+
+stm_err_t gpio_set_level(int port, int num, bool level)
+{
+	if ((port < 0) || (port >= VLCD_NUM_PORT) || (num < 0) || (num >= VLCD_NUM_PIN)) {
+		return STM_FAIL;
+	}
+
+	pthread_mutex_lock(&lock);
+	now_us++;
+	bool edge = pin[port][num] != level;
+	pin[port][num] = level;
+	if (edge && ((num == VLCD_PIN_EN) || (num == VLCD_PIN_EN2))) {
+		_en_edge(port, num, level);
+	}
+	pthread_mutex_unlock(&lock);
+
+	return STM_OK;
+}
+
+int gpio_get_level(int port, int num)
+{
+	pthread_mutex_lock(&lock);
+	int level = pin[port][num];
+	pthread_mutex_unlock(&lock);
+
+	return level;
+}
+
+stm_err_t i2c_config(i2c_cfg_t *cfg)
+{
+	if (cfg->i2c_num >= I2C_NUM_MAX) {
+		return STM_FAIL;
+	}
+	i2c_speed[cfg->i2c_num] = cfg->clk_speed ? cfg->clk_speed : VLCD_I2C_SPEED_DEFAULT;
+
+	return STM_OK;
+}
+
+stm_err_t i2c_master_write_bytes(i2c_num_t i2c_num, uint16_t dev_addr, uint8_t *data, uint16_t length, uint32_t timeout_ms)
+{
+	if (i2c_num >= I2C_NUM_MAX) {
+		return STM_FAIL;
+	}
+
+	pthread_mutex_lock(&lock);
+	vlcd_t *vlcd = &vlcd_i2c[i2c_num];
+	uint32_t byte_us = 9000000 / (i2c_speed[i2c_num] ? i2c_speed[i2c_num] : VLCD_I2C_SPEED_DEFAULT);
+
+	/* Start and address, then each expander byte. P0 RS, P1 RW, P2 EN, P3 backlight, P4 to P7 D4 to D7 */
+	now_us += byte_us;
+	for (uint16_t i = 0; i < length; i++) {
+		now_us += byte_us;
+		if ((i2c_last[i2c_num] & 0x04) && !(data[i] & 0x04) && !(data[i] & 0x02)) {
+			_latch(&vlcd->ctrl[0], data[i] & 0x01, data[i] >> 4);
+		}
+		i2c_last[i2c_num] = data[i];
+		vlcd->backlight = data[i] & 0x08;
+	}
+	now_us += byte_us;
+
+	vlcd->num_byte += length;
+	vlcd->num_txn++;
+	if (length > vlcd->max_txn_len) {
+		vlcd->max_txn_len = length;
+	}
+	pthread_mutex_unlock(&lock);
+
+	return STM_OK;
+}
+
+void vQueueDelete(QueueHandle_t queue)
+{
+	free(queue);
+}
+
+static SemaphoreHandle_t _sem_create(UBaseType_t max_count, UBaseType_t init_count)
+{
+	vsem_t *sem = malloc(sizeof(vsem_t));
+
+	if (sem) {
+		sem->count = init_count;
+		sem->max_count = max_count;
+	}
+
+	return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+	return _sem_create(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+	return _sem_create(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t init_count)
+{
+	return _sem_create(max_count, init_count);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t handle, TickType_t ticks)
+{
+	vsem_t *sem = handle;
+	BaseType_t ret = pdFALSE;
+
+	/* Only blocking forever or polling are needed */
+	pthread_mutex_lock(&lock);
+	while (!sem->count && (ticks == portMAX_DELAY)) {
+		pthread_cond_wait(&sem_cond, &lock);
+	}
+	if (sem->count) {
+		sem->count--;
+		ret = pdTRUE;
+	}
+	pthread_mutex_unlock(&lock);
+
+	return ret;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t handle)
+{
+	vsem_t *sem = handle;
+	BaseType_t ret = pdFALSE;
+
+	pthread_mutex_lock(&lock);
+	if (sem->count < sem->max_count) {
+		sem->count++;
+		ret = pdTRUE;
+	}
+	pthread_cond_broadcast(&sem_cond);
+	pthread_mutex_unlock(&lock);
+
+	return ret;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+	vlcd_advance_us((ticks ? ticks : 1) * portTICK_PERIOD_MS * 1000);
+	sched_yield();
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+	pthread_mutex_lock(&lock);
+	TickType_t tick = now_us / (portTICK_PERIOD_MS * 1000);
+	pthread_mutex_unlock(&lock);
+
+	return tick;
+}
+
+typedef struct {
+	TaskFunction_t 		func;
+	void 				*arg;
+} task_start_t;
+
+static void *_task_entry(void *arg)
+{
+	task_start_t start = *(task_start_t *)arg;
+
+	free(arg);
+	start.func(start.arg);
+
+	return NULL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t func, const char *name, uint16_t stack_size, void *arg, UBaseType_t priority, TaskHandle_t *task)
+{
+	task_start_t *start = malloc(sizeof(task_start_t));
+	pthread_t thread;
+
+	if (!start) {
+		return pdFAIL;
+	}
+	start->func = func;
+	start->arg = arg;
+	if (pthread_create(&thread, NULL, _task_entry, start)) {
+		free(start);
+		return pdFAIL;
+	}
+	pthread_detach(thread);
+	if (task) {
+		*task = (TaskHandle_t)(uintptr_t)thread;
+	}
+
+	return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+	/* Only tasks deleting themselves */
+	pthread_exit(NULL);
+}
+
+void taskYIELD(void)
+{
+	sched_yield();
+}
@@ -0,0 +1,28 @@
+/* Host stand-in for stm-idf GPIO driver */
+#ifndef _DRIVER_GPIO_H_
+#define _DRIVER_GPIO_H_
+
+#include <stdbool.h>
+#include "stm_err.h"
+
+typedef enum {
+	GPIO_INPUT = 0,
+	GPIO_OUTPUT_PP,
+} gpio_mode_t;
+
+typedef enum {
+	GPIO_REG_PULL_NONE = 0,
+} gpio_reg_pull_mode_t;
+
+typedef struct {
+	int 					gpio_port;
+	int 					gpio_num;
+	gpio_mode_t 			mode;
+	gpio_reg_pull_mode_t 	reg_pull_mode;
+} gpio_cfg_t;
+
+stm_err_t gpio_config(gpio_cfg_t *cfg);
+stm_err_t gpio_set_level(int port, int num, bool level);
+int gpio_get_level(int port, int num);
+
+#endif /* _DRIVER_GPIO_H_ */
@@ -0,0 +1,29 @@
+/* Host stand-in for stm-idf I2C driver */
+#ifndef _DRIVER_I2C_H_
+#define _DRIVER_I2C_H_
+
+#include "stm_err.h"
+
+typedef enum {
+	I2C_NUM_1 = 0,
+	I2C_NUM_2,
+	I2C_NUM_3,
+	I2C_NUM_MAX,
+} i2c_num_t;
+
+typedef enum {
+	I2C_PINS_PACK_1 = 0,
+	I2C_PINS_PACK_2,
+	I2C_PINS_PACK_MAX,
+} i2c_pins_pack_t;
+
+typedef struct {
+	i2c_num_t 				i2c_num;
+	i2c_pins_pack_t 		i2c_pins_pack;
+	uint32_t 				clk_speed;
+} i2c_cfg_t;
+
+stm_err_t i2c_config(i2c_cfg_t *cfg);
+stm_err_t i2c_master_write_bytes(i2c_num_t i2c_num, uint16_t dev_addr, uint8_t *data, uint16_t length, uint32_t timeout_ms);
+
+#endif /* _DRIVER_I2C_H_ */
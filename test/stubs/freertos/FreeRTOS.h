@@ -0,0 +1,19 @@
+/* Host stand-in for FreeRTOS, one millisecond tick */
+#ifndef _FREERTOS_H_
+#define _FREERTOS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint32_t TickType_t;
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+
+#define portTICK_PERIOD_MS			1
+#define portMAX_DELAY				0xFFFFFFFFu
+#define pdPASS						1
+#define pdFAIL						0
+#define pdTRUE						1
+#define pdFALSE						0
+
+#endif /* _FREERTOS_H_ */
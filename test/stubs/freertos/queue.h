@@ -0,0 +1,10 @@
+#ifndef _FREERTOS_QUEUE_H_
+#define _FREERTOS_QUEUE_H_
+
+#include "FreeRTOS.h"
+
+typedef void *QueueHandle_t;
+
+void vQueueDelete(QueueHandle_t queue);
+
+#endif /* _FREERTOS_QUEUE_H_ */
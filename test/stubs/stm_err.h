@@ -0,0 +1,16 @@
+/* Host stand-in for stm-idf error codes, only what the driver uses */
+#ifndef _STM_ERR_H_
+#define _STM_ERR_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef int stm_err_t;
+
+#define STM_OK						0
+#define STM_FAIL					-1
+#define STM_ERR_INVALID_ARG			0x102
+
+#endif /* _STM_ERR_H_ */
@@ -0,0 +1,9 @@
+/* Host stand-in for stm-idf logging, errors go to stderr */
+#ifndef _STM_LOG_H_
+#define _STM_LOG_H_
+
+#include <stdio.h>
+
+#define STM_LOGE(tag, fmt, ...)		fprintf(stderr, "E %s: " fmt "\n", tag, ##__VA_ARGS__)
+
+#endif /* _STM_LOG_H_ */
@@ -0,0 +1,1183 @@
+/*
+ * Host tests of driver internals. Driver source is included so that static
+ * helpers can be checked directly, buses and RTOS come from stubs.c and drive
+ * the virtual controllers of vlcd.h.
+ */
+#include <limits.h>
+
+#include "../hd44780.c"
+#include "vlcd.h"
+
+static int num_fail;
+
+#define TEST_CHECK(cond)	do { if (!(cond)) { printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); num_fail++; } } while (0)
+
+#define TEST_PORT			0			/* GPIO port of parallel LCDs */
+
+static hd44780_cfg_t _test_cfg_serial(hd44780_size_t size, i2c_num_t i2c_num)
+{
+	hd44780_cfg_t cfg = {
+		.size = size,
+		.comm_mode = HD44780_COMM_MODE_SERIAL,
+		.get_time_us = vlcd_time_us,
+	};
+	cfg.hw_info.i2c_num = i2c_num;
+
+	return cfg;
+}
+
+static hd44780_cfg_t _test_cfg_4bit(hd44780_size_t size, int port, bool pin_rw)
+{
+	hd44780_cfg_t cfg = {
+		.size = size,
+		.comm_mode = HD44780_COMM_MODE_4BIT,
+		.get_time_us = vlcd_time_us,
+		.hw_info = {
+			.gpio_port_rs = port, .gpio_num_rs = VLCD_PIN_RS,
+			.gpio_port_rw = pin_rw ? port : -1, .gpio_num_rw = pin_rw ? VLCD_PIN_RW : -1,
+			.gpio_port_en = port, .gpio_num_en = VLCD_PIN_EN,
+			.gpio_port_d0 = -1, .gpio_num_d0 = -1,
+			.gpio_port_d1 = -1, .gpio_num_d1 = -1,
+			.gpio_port_d2 = -1, .gpio_num_d2 = -1,
+			.gpio_port_d3 = -1, .gpio_num_d3 = -1,
+			.gpio_port_d4 = port, .gpio_num_d4 = VLCD_PIN_D4,
+			.gpio_port_d5 = port, .gpio_num_d5 = VLCD_PIN_D4 + 1,
+			.gpio_port_d6 = port, .gpio_num_d6 = VLCD_PIN_D4 + 2,
+			.gpio_port_d7 = port, .gpio_num_d7 = VLCD_PIN_D4 + 3,
+			.gpio_port_en2 = port, .gpio_num_en2 = VLCD_PIN_EN2,
+		},
+	};
+
+	return cfg;
+}
+
+static hd44780_handle_t _test_init(hd44780_size_t size)
+{
+	hd44780_cfg_t cfg = _test_cfg_serial(size, I2C_NUM_1);
+
+	vlcd_reset();
+
+	return hd44780_init(&cfg);
+}
+
+static hd44780_handle_t _test_init_4bit(hd44780_size_t size, bool pin_rw)
+{
+	hd44780_cfg_t cfg = _test_cfg_4bit(size, TEST_PORT, pin_rw);
+
+	vlcd_reset();
+
+	return hd44780_init(&cfg);
+}
+
+static vlcd_t *_test_vlcd(hd44780_handle_t handle)
+{
+	if (handle->comm_mode == HD44780_COMM_MODE_SERIAL) {
+		return &vlcd_i2c[handle->ctrl[0].hw_info.i2c_num];
+	}
+
+	return &vlcd_port[handle->ctrl[0].hw_info.gpio_port_en];
+}
+
+/* Controllers hold what the driver believes, no write was lost to a busy controller */
+static bool _test_lcd_matches(hd44780_handle_t handle)
+{
+	vlcd_t *vlcd = _test_vlcd(handle);
+
+	for (uint8_t i = 0; i < handle->num_ctrl; i++) {
+		hd44780_ctrl_t *ctrl = &handle->ctrl[i];
+		vlcd_ctrl_t *lcd = &vlcd->ctrl[i];
+		bool on = handle->display_on;
+
+		/* CGRAM has no mirror, writes held while display is off are compared after wake */
+		if (memcmp(ctrl->shadow, lcd->ddram, LCD_DDRAM_SIZE) ||
+		    (on && memcmp(handle->cgram, lcd->cgram, sizeof(handle->cgram))) ||
+		    ((on ? ctrl->addr : ctrl->lcd_addr) != lcd->ac) ||
+		    ((on ? ctrl->addr_cgram : ctrl->lcd_addr_cgram) != lcd->ac_cgram) ||
+		    ((on ? ctrl->shift : ctrl->lcd_shift) != lcd->shift) ||
+		    (on != lcd->display_on) || !lcd->four_bit || lcd->num_violation) {
+			printf("controller %u: ac %02X/%02X shift %u/%u violations %u\n", i,
+			       on ? ctrl->addr : ctrl->lcd_addr, lcd->ac, on ? ctrl->shift : ctrl->lcd_shift, lcd->shift, lcd->num_violation);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool _test_row_is(hd44780_handle_t handle, uint8_t col, uint8_t row, const char *text)
+{
+	for (uint8_t i = 0; text[i]; i++) {
+		if (*_cell_fb(handle, col + i, row) != (uint8_t)text[i]) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/* Screen content as seen on glass, display shift applied */
+static bool _test_lcd_row_is(hd44780_handle_t handle, uint8_t col, uint8_t row, const char *text)
+{
+	vlcd_ctrl_t *lcd = &_test_vlcd(handle)->ctrl[lcd_geometry[handle->size].row_ctrl[row]];
+	uint8_t base = lcd_geometry[handle->size].row_addr[row];
+
+	for (uint8_t i = 0; text[i]; i++) {
+		uint8_t addr = (base & 0x40) | (((base & 0x3F) + col + i + lcd->shift) % LCD_DDRAM_LINE_SIZE);
+		if (lcd->ddram[vlcd_ddram_index(addr)] != (uint8_t)text[i]) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void test_charset_lookup(void)
+{
+	uint8_t code;
+
+	TEST_CHECK(hd44780_charset_lookup(HD44780_CHARSET_A00, 'A', &code) && (code == 0x41));
+	TEST_CHECK(hd44780_charset_lookup(HD44780_CHARSET_A02, 'A', &code) && (code == 0x41));
+
+	/* A00 has katakana and yen sign where A02 has Latin-1 and backslash */
+	TEST_CHECK(hd44780_charset_lookup(HD44780_CHARSET_A00, 0xFF71, &code) && (code == 0xB1));
+	TEST_CHECK(!hd44780_charset_lookup(HD44780_CHARSET_A02, 0xFF71, &code));
+	TEST_CHECK(!hd44780_charset_lookup(HD44780_CHARSET_A00, 0x00C4, &code));
+	TEST_CHECK(hd44780_charset_lookup(HD44780_CHARSET_A02, 0x00C4, &code) && (code == 0xC4));
+	TEST_CHECK(!hd44780_charset_lookup(HD44780_CHARSET_A00, '\\', &code));
+	TEST_CHECK(hd44780_charset_lookup(HD44780_CHARSET_A02, '\\', &code) && (code == 0x5C));
+
+	/* Not in ROM, euro sign comes from a fallback glyph */
+	TEST_CHECK(!hd44780_charset_lookup(HD44780_CHARSET_A00, 0x20AC, &code));
+	TEST_CHECK(!hd44780_charset_lookup(HD44780_CHARSET_A02, 0x20AC, &code));
+	TEST_CHECK(hd44780_charset_glyph(0x20AC) != NULL);
+	TEST_CHECK(hd44780_charset_glyph(' ') == NULL);
+}
+
+static void test_utf8(void)
+{
+	hd44780_handle_t handle = _test_init(HD44780_SIZE_20_4);
+
+	TEST_CHECK(handle);
+
+	/* Characters in ROM are translated, euro sign is loaded into first free slot and reused */
+	TEST_CHECK(!hd44780_set_charset(handle, HD44780_CHARSET_A02));
+	hd44780_gotoxy(handle, 0, 0);
+	TEST_CHECK(!hd44780_write_utf8(handle, "\xC3\x84" "A\xE2\x82\xAC\xE2\x82\xAC"));
+	TEST_CHECK(_test_row_is(handle, 0, 0, "\xC4" "A") && !*_cell_fb(handle, 2, 0) && !*_cell_fb(handle, 3, 0));
+	TEST_CHECK((handle->cgram_kind[0] == CGRAM_KIND_FALLBACK) && (handle->cgram_owner[0] == 0x20AC));
+	TEST_CHECK(!memcmp(&handle->cgram[0], hd44780_charset_glyph(0x20AC), 8));
+	TEST_CHECK(_test_lcd_matches(handle));
+
+	/* User slot is never taken, glyph without fallback is shown as '?' */
+	static const uint8_t smile[8] = {0x00, 0x0A, 0x00, 0x00, 0x11, 0x0E, 0x00, 0x00};
+	TEST_CHECK(!hd44780_load_custom_char(handle, 1, smile));
+	TEST_CHECK(!hd44780_write_utf8(handle, "\xE2\x9C\x93\xF0\x9F\x98\x80"));
+	TEST_CHECK((handle->cgram_kind[1] == CGRAM_KIND_USER) && (handle->cgram_kind[2] == CGRAM_KIND_FALLBACK));
+	TEST_CHECK((*_cell_fb(handle, 4, 0) == 2) && (*_cell_fb(handle, 5, 0) == HD44780_CHARSET_REPLACEMENT));
+
+	/* No free slot left, glyph is shown as '?' */
+	for (uint8_t slot = 3; slot < LCD_NUM_CGRAM_SLOT; slot++) {
+		TEST_CHECK(!hd44780_load_custom_char(handle, slot, smile));
+	}
+	TEST_CHECK(!hd44780_write_utf8(handle, "\xCE\x94"));
+	TEST_CHECK(*_cell_fb(handle, 6, 0) == HD44780_CHARSET_REPLACEMENT);
+	TEST_CHECK(_test_lcd_matches(handle));
+
+	/* Fallback slot can not be taken as custom character until clear releases it */
+	TEST_CHECK(hd44780_load_custom_char(handle, 0, smile));
+	TEST_CHECK(!hd44780_clear(handle));
+	TEST_CHECK((handle->cgram_kind[0] == CGRAM_KIND_FREE) && (handle->cgram_kind[1] == CGRAM_KIND_USER));
+	TEST_CHECK(!hd44780_load_custom_char(handle, 0, smile));
+	TEST_CHECK(_test_lcd_matches(handle));
+
+	hd44780_destroy(handle);
+}
+
+static void test_calibrate(void)
+{
+	vlcd_t *vlcd = &vlcd_port[TEST_PORT];
+	hd44780_timing_t timing;
+
+	/* Without RW pin busy flag can not be read */
+	hd44780_handle_t handle = _test_init_4bit(HD44780_SIZE_16_2, false);
+	TEST_CHECK(handle && hd44780_calibrate_timing(handle, 0, &timing));
+	hd44780_destroy(handle);
+
+	handle = _test_init_4bit(HD44780_SIZE_40_4, true);
+	TEST_CHECK(handle);
+
+	/* Second controller is slower except for clear, busy flag follows these */
+	vlcd->ctrl[0].clear_us = 1800;
+	vlcd->ctrl[0].cmd_us = 40;
+	vlcd->ctrl[0].data_us = 45;
+	vlcd->ctrl[1].clear_us = 1600;
+	vlcd->ctrl[1].cmd_us = 70;
+	vlcd->ctrl[1].data_us = 90;
+
+	hd44780_fb_write(handle, 3, 0, (const uint8_t *)"top", 3);
+	hd44780_fb_write(handle, 5, 3, (const uint8_t *)"bottom", 6);
+	TEST_CHECK(!hd44780_flush(handle));
+	hd44780_gotoxy(handle, 10, 1);
+
+	TEST_CHECK(!hd44780_calibrate_timing(handle, 0, &timing));
+
+	/* Worst of both controllers, polling adds a few microseconds */
+	TEST_CHECK((timing.clear_us >= 1800) && (timing.clear_us < 1800 + 20));
+	TEST_CHECK((timing.home_us >= 1800) && (timing.home_us < 1800 + 20));
+	TEST_CHECK((timing.cmd_us >= 70) && (timing.cmd_us < 70 + 20));
+	TEST_CHECK((timing.data_us >= 90) && (timing.data_us < 90 + 20));
+	TEST_CHECK(!memcmp(&handle->timing, &timing, sizeof(timing)));
+
+	/* Content and address counter survive the clears */
+	TEST_CHECK(_test_lcd_matches(handle));
+	TEST_CHECK(_test_lcd_row_is(handle, 3, 0, "top") && _test_lcd_row_is(handle, 5, 3, "bottom"));
+	hd44780_write_char(handle, '!');
+	TEST_CHECK(_test_lcd_row_is(handle, 10, 1, "!"));
+
+	/* Margin is added on top */
+	TEST_CHECK(!hd44780_calibrate_timing(handle, 50, &timing));
+	TEST_CHECK((timing.data_us >= 135) && (timing.data_us < 135 + 30));
+	TEST_CHECK(_test_lcd_matches(handle));
+
+	hd44780_destroy(handle);
+}
+
+static void test_trace(void)
+{
+	hd44780_handle_t handle = _test_init_4bit(HD44780_SIZE_40_4, false);
+	hd44780_trace_event_t buf[8];
+	hd44780_trace_event_t events[8];
+	hd44780_trace_header_t header;
+
+	TEST_CHECK(handle);
+	TEST_CHECK(!hd44780_trace_start(handle, buf, 8));
+
+	/* Row 2 is on second controller, without RW pin every write waits for the one before */
+	hd44780_gotoxy(handle, 1, 2);
+	hd44780_write_char(handle, 'T');
+	TEST_CHECK(!hd44780_trace_read(handle, &header, events, 8));
+	TEST_CHECK((header.magic == HD44780_TRACE_MAGIC) && (header.version == HD44780_TRACE_VERSION));
+	TEST_CHECK((header.size == HD44780_SIZE_40_4) && (header.comm_mode == HD44780_COMM_MODE_4BIT));
+	TEST_CHECK((header.num_event == 4) && !header.num_dropped);
+	TEST_CHECK((events[0].type == (HD44780_TRACE_WAIT | HD44780_TRACE_CTRL_1)) && (events[0].value == 0x01));
+	TEST_CHECK(events[0].duration_us > 1000);
+	TEST_CHECK((events[1].type == (HD44780_TRACE_CMD | HD44780_TRACE_CTRL_1)) && (events[1].value == 0x81));
+	TEST_CHECK((events[2].type == (HD44780_TRACE_WAIT | HD44780_TRACE_CTRL_1)) && (events[2].value == 0x81));
+	TEST_CHECK((events[3].type == (HD44780_TRACE_DATA | HD44780_TRACE_CTRL_1)) && (events[3].value == 'T'));
+	TEST_CHECK(events[3].timestamp_us - events[1].timestamp_us >= events[1].duration_us + events[2].duration_us);
+
+	/* Ring buffer keeps newest events, overwritten ones are counted once */
+	hd44780_gotoxy(handle, 0, 0);
+	TEST_CHECK(!hd44780_write_string(handle, (uint8_t *)"0123456789"));
+	TEST_CHECK(!hd44780_trace_stop(handle));
+	hd44780_write_char(handle, 'x');
+	TEST_CHECK(!hd44780_trace_read(handle, &header, events, 8));
+	TEST_CHECK((header.num_event == 8) && header.num_dropped);
+	TEST_CHECK((events[7].type == HD44780_TRACE_DATA) && (events[7].value == '9'));
+	TEST_CHECK(!hd44780_trace_read(handle, &header, events, 8));
+	TEST_CHECK(!header.num_event && !header.num_dropped);
+	TEST_CHECK(_test_lcd_matches(handle));
+
+	hd44780_destroy(handle);
+}
+
+static void test_viewport(void)
+{
+	hd44780_handle_t handle = _test_init(HD44780_SIZE_16_2);
+	vlcd_ctrl_t *lcd = &vlcd_i2c[I2C_NUM_1].ctrl[0];
+	hd44780_canvas_t canvas;
+	uint8_t buf[48 * 3];
+
+	TEST_CHECK(handle);
+	TEST_CHECK(!hd44780_canvas_init(&canvas, buf, 48, 3));
+	TEST_CHECK(!hd44780_canvas_write(&canvas, 0, 0, (const uint8_t *)"abcdefghijklmnopqrstuvwxyz0123456789ABCDEFGHIJKL"));
+	TEST_CHECK(!hd44780_canvas_write(&canvas, 2, 1, (const uint8_t *)"second"));
+	TEST_CHECK(!hd44780_canvas_write(&canvas, 0, 2, (const uint8_t *)"third"));
+
+	TEST_CHECK(!hd44780_set_viewport(handle, &canvas, 0, 0));
+	TEST_CHECK(_test_lcd_row_is(handle, 0, 0, "abcdefghijklmnop") && _test_lcd_row_is(handle, 0, 1, "  second        "));
+
+	/* One column step is one display shift and the entering column */
+	uint32_t num_cmd = lcd->num_cmd, num_data = lcd->num_data;
+	TEST_CHECK(!hd44780_set_viewport(handle, &canvas, 1, 0));
+	TEST_CHECK(lcd->shift == 1);
+	TEST_CHECK(lcd->num_data - num_data <= 2);
+	TEST_CHECK(lcd->num_cmd - num_cmd <= 3);
+	TEST_CHECK(_test_lcd_row_is(handle, 0, 0, "bcdefghijklmnopq") && _test_lcd_row_is(handle, 0, 1, " second         "));
+
+	/* Past DDRAM line length and back, canvas right edge pads with spaces */
+	TEST_CHECK(!hd44780_set_viewport(handle, &canvas, 38, 0));
+	TEST_CHECK(_test_lcd_row_is(handle, 0, 0, "CDEFGHIJKL      ") && _test_lcd_row_is(handle, 0, 1, "                "));
+	TEST_CHECK(_test_lcd_matches(handle));
+
+	/* Direct writes land on screen position, display shift included */
+	hd44780_gotoxy(handle, 3, 1);
+	hd44780_write_string(handle, (uint8_t *)"here");
+	TEST_CHECK(_test_lcd_row_is(handle, 0, 1, "   here         "));
+	TEST_CHECK(!hd44780_set_viewport(handle, &canvas, 5, 0));
+	TEST_CHECK(_test_lcd_row_is(handle, 0, 0, "fghijklmnopqrstu"));
+	TEST_CHECK(_test_lcd_matches(handle));
+	hd44780_destroy(handle);
+
+	/* Rows of 20x4 share DDRAM lines, viewport rewrites cells instead of shifting */
+	handle = _test_init(HD44780_SIZE_20_4);
+	TEST_CHECK(handle);
+	TEST_CHECK(!hd44780_set_viewport(handle, &canvas, 3, 0));
+	TEST_CHECK(!handle->ctrl[0].shift);
+	TEST_CHECK(_test_lcd_row_is(handle, 0, 0, "defghijklmnopqrstuvw") && _test_lcd_row_is(handle, 0, 2, "rd                  "));
+	TEST_CHECK(_test_lcd_matches(handle));
+	hd44780_destroy(handle);
+}
+
+static void test_40x4(void)
+{
+	hd44780_handle_t handle = _test_init_4bit(HD44780_SIZE_40_4, true);
+	vlcd_t *vlcd = &vlcd_port[TEST_PORT];
+
+	TEST_CHECK(handle && (handle->num_ctrl == 2));
+	TEST_CHECK(_test_lcd_matches(handle));
+
+	/* Rows 0 and 1 on first controller, rows 2 and 3 on second */
+	for (uint8_t row = 0; row < 4; row++) {
+		uint8_t text[40];
+		for (uint8_t col = 0; col < 40; col++) {
+			text[col] = 'A' + (row * 7 + col) % 26;
+		}
+		hd44780_fb_write(handle, 0, row, text, 40);
+	}
+	TEST_CHECK(!hd44780_flush(handle));
+	TEST_CHECK(_test_lcd_matches(handle));
+	TEST_CHECK((vlcd->ctrl[0].num_data >= 80) && (vlcd->ctrl[1].num_data >= 80));
+
+	/* Direct writes follow the row */
+	hd44780_gotoxy(handle, 39, 3);
+	hd44780_write_char(handle, '*');
+	hd44780_gotoxy(handle, 0, 1);
+	hd44780_write_char(handle, '+');
+	TEST_CHECK(_test_lcd_row_is(handle, 39, 3, "*") && _test_lcd_row_is(handle, 0, 1, "+"));
+
+	/* Clear and CGRAM reach both controllers */
+	static const uint8_t box[8] = {0x1F, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x1F};
+	TEST_CHECK(!hd44780_load_custom_char(handle, 3, box));
+	TEST_CHECK(!memcmp(&vlcd->ctrl[1].cgram[3 * 8], box, 8));
+	TEST_CHECK(!hd44780_clear(handle));
+	TEST_CHECK(_test_lcd_matches(handle));
+	hd44780_destroy(handle);
+
+	/* Without RW pin, execution is waited by deadline of each controller */
+	handle = _test_init_4bit(HD44780_SIZE_40_4, false);
+	TEST_CHECK(handle);
+	for (uint8_t row = 0; row < 4; row++) {
+		hd44780_fb_write(handle, row, row, (const uint8_t *)"interleaved", 11);
+	}
+	TEST_CHECK(!hd44780_flush(handle));
+	TEST_CHECK(!hd44780_clear(handle));
+	hd44780_gotoxy(handle, 2, 2);
+	hd44780_write_string(handle, (uint8_t *)"after clear");
+	TEST_CHECK(_test_lcd_matches(handle) && _test_lcd_row_is(handle, 2, 2, "after clear"));
+	hd44780_destroy(handle);
+}
+
+static void test_remain_wrap(void)
+{
+	hd44780_handle_t handle = _test_init(HD44780_SIZE_16_2);
+	hd44780_ctrl_t *ctrl = &handle->ctrl[0];
+
+	TEST_CHECK(handle);
+
+	/* Deadline past the wrap of the time source is still ahead */
+	vlcd_set_time_us(0xFFFFFFF0);
+	ctrl->ready_us = 0xFFFFFFF0 + 100;
+	TEST_CHECK(_remain_us(handle, ctrl) == 100);
+
+	/* Deadline just passed */
+	vlcd_set_time_us(0x10);
+	ctrl->ready_us = 0x08;
+	TEST_CHECK(_remain_us(handle, ctrl) == -8);
+
+	/* Deadline left behind more than half the time source range ago looks ahead, it is past */
+	vlcd_set_time_us(0x80000010);
+	ctrl->ready_us = 0x08;
+	TEST_CHECK(_remain_us(handle, ctrl) == 0);
+
+	/* Longest execution plus a tick is still waited for */
+	vlcd_set_time_us(0x1000);
+	ctrl->ready_us = 0x1000 + TIMING_MAX_US + US_PER_TICK;
+	TEST_CHECK(_remain_us(handle, ctrl) == TIMING_MAX_US + US_PER_TICK);
+
+	hd44780_destroy(handle);
+}
+
+static void test_deadline(void)
+{
+	hd44780_cfg_t cfg = _test_cfg_4bit(HD44780_SIZE_20_4, TEST_PORT, false);
+	vlcd_ctrl_t *lcd = &vlcd_port[TEST_PORT].ctrl[0];
+
+	/* RTOS tick time source, deadlines are rounded up to whole ticks */
+	cfg.get_time_us = NULL;
+	vlcd_reset();
+	hd44780_handle_t handle = hd44780_init(&cfg);
+	TEST_CHECK(handle);
+	TEST_CHECK(!hd44780_clear(handle));
+	hd44780_write_string(handle, (uint8_t *)"tick");
+	hd44780_gotoxy(handle, 0, 3);
+	hd44780_write_string(handle, (uint8_t *)"source");
+	TEST_CHECK(_test_lcd_matches(handle) && _test_lcd_row_is(handle, 0, 3, "source"));
+	hd44780_destroy(handle);
+
+	/* Microsecond time source, work done between writes is not waited again */
+	cfg.get_time_us = vlcd_time_us;
+	vlcd_reset();
+	handle = hd44780_init(&cfg);
+	TEST_CHECK(handle);
+	hd44780_trace_event_t buf[64];
+	hd44780_trace_header_t header;
+	vlcd_advance_us(timing_default.clear_us);
+	TEST_CHECK(!hd44780_trace_start(handle, buf, 64));
+	for (int i = 0; i < 20; i++) {
+		vlcd_advance_us(timing_default.data_us);
+		hd44780_write_char(handle, 'a' + i);
+	}
+	TEST_CHECK(!hd44780_trace_read(handle, &header, buf, 64));
+	TEST_CHECK(header.num_event == 20);
+	for (uint32_t i = 0; i < header.num_event; i++) {
+		TEST_CHECK(buf[i].type == HD44780_TRACE_DATA);
+	}
+	TEST_CHECK(!hd44780_trace_stop(handle));
+	TEST_CHECK(!hd44780_clear(handle));
+	hd44780_write_char(handle, 'c');
+	TEST_CHECK(_test_lcd_matches(handle) && !lcd->num_violation);
+
+	/* Timing profile shorter than controller loses writes */
+	hd44780_timing_t fast = {.clear_us = 2000, .home_us = 2000, .cmd_us = 50, .data_us = 10};
+	TEST_CHECK(!hd44780_set_timing(handle, &fast));
+	hd44780_write_string(handle, (uint8_t *)"too fast");
+	TEST_CHECK(lcd->num_violation);
+	hd44780_destroy(handle);
+}
+
+static void test_static(void)
+{
+	static hd44780_static_t storage;
+	static uint8_t fb[HD44780_FB_SIZE(HD44780_SIZE_40_4)];
+	hd44780_cfg_t cfg = _test_cfg_4bit(HD44780_SIZE_40_4, TEST_PORT, true);
+
+	TEST_CHECK(sizeof(hd44780_t) <= sizeof(hd44780_static_t));
+
+	/* Frame buffer must hold both controllers */
+	vlcd_reset();
+	TEST_CHECK(!hd44780_init_static(&cfg, &storage, fb, HD44780_FB_SIZE(HD44780_SIZE_20_4)));
+	TEST_CHECK(!hd44780_init_static(&cfg, NULL, fb, sizeof(fb)));
+
+	hd44780_handle_t handle = hd44780_init_static(&cfg, &storage, fb, sizeof(fb));
+	TEST_CHECK(handle == (hd44780_handle_t)&storage);
+	hd44780_fb_write(handle, 0, 3, (const uint8_t *)"static", 6);
+	TEST_CHECK(!hd44780_flush(handle));
+	TEST_CHECK(_test_lcd_matches(handle) && _test_lcd_row_is(handle, 0, 3, "static"));
+	TEST_CHECK((_cell_fb(handle, 0, 3) >= fb) && (_cell_fb(handle, 5, 3) < &fb[sizeof(fb)]));
+
+	/* Storage is not freed and can be reused */
+	hd44780_destroy(handle);
+	handle = hd44780_init_static(&cfg, &storage, fb, sizeof(fb));
+	TEST_CHECK(handle && _test_lcd_matches(handle));
+	hd44780_destroy(handle);
+}
+
+static void test_field(void)
+{
+	hd44780_handle_t handle = _test_init(HD44780_SIZE_20_4);
+	vlcd_ctrl_t *lcd = &vlcd_i2c[I2C_NUM_1].ctrl[0];
+	hd44780_field_t temp, hum;
+	uint8_t temp_buf[6], hum_buf[4];
+
+	TEST_CHECK(handle);
+	TEST_CHECK(!hd44780_field_init(&temp, temp_buf, 0, 0, sizeof(temp_buf)));
+	TEST_CHECK(!hd44780_field_init(&hum, hum_buf, 10, 1, sizeof(hum_buf)));
+	TEST_CHECK(!hd44780_field_register(handle, &temp));
+	TEST_CHECK(!hd44780_field_register(handle, &hum));
+
+	/* Published text is padded or truncated to width */
+	TEST_CHECK(!hd44780_field_publish(&temp, (const uint8_t *)"21.5C"));
+	TEST_CHECK(!hd44780_field_publish(&hum, (const uint8_t *)"45%RH"));
+	TEST_CHECK(!hd44780_field_render(handle));
+	TEST_CHECK(_test_lcd_row_is(handle, 0, 0, "21.5C ") && _test_lcd_row_is(handle, 10, 1, "45%R"));
+
+	/* Nothing published, nothing sent */
+	uint32_t num_data = lcd->num_data;
+	TEST_CHECK(!hd44780_field_render(handle));
+	TEST_CHECK(lcd->num_data == num_data);
+
+	/* Publisher still writing, field is left for next render */
+	TEST_CHECK(!hd44780_field_publish(&temp, (const uint8_t *)"22.0C"));
+	temp.seq++;
+	TEST_CHECK(!hd44780_field_render(handle));
+	TEST_CHECK(_test_lcd_row_is(handle, 0, 0, "21.5C "));
+	temp.seq++;
+	TEST_CHECK(!hd44780_field_render(handle));
+	TEST_CHECK(_test_lcd_row_is(handle, 0, 0, "22.0C "));
+
+	/* Unregistered field stays on screen and is no longer drawn */
+	TEST_CHECK(!hd44780_field_unregister(handle, &hum));
+	TEST_CHECK(!hd44780_field_publish(&hum, (const uint8_t *)"50"));
+	TEST_CHECK(!hd44780_field_render(handle));
+	TEST_CHECK(_test_lcd_row_is(handle, 10, 1, "45%R"));
+	TEST_CHECK(_test_lcd_matches(handle));
+
+	hd44780_destroy(handle);
+}
+
+static void test_write_int(void)
+{
+	hd44780_handle_t handle = _test_init(HD44780_SIZE_20_4);
+
+	TEST_CHECK(handle);
+
+	hd44780_gotoxy(handle, 0, 0);
+	TEST_CHECK(!hd44780_write_int(handle, INT_MIN));
+	TEST_CHECK(_test_row_is(handle, 0, 0, "-2147483648 "));
+
+	hd44780_gotoxy(handle, 0, 1);
+	TEST_CHECK(!hd44780_write_int(handle, INT_MAX));
+	TEST_CHECK(_test_row_is(handle, 0, 1, "2147483647 "));
+
+	hd44780_gotoxy(handle, 0, 2);
+	TEST_CHECK(!hd44780_write_int(handle, 0));
+	TEST_CHECK(_test_row_is(handle, 0, 2, "0 "));
+
+	hd44780_destroy(handle);
+}
+
+static void test_write_float(void)
+{
+	hd44780_handle_t handle = _test_init(HD44780_SIZE_20_4);
+
+	TEST_CHECK(handle);
+
+	/* Rounding carries into one more digit */
+	hd44780_gotoxy(handle, 0, 0);
+	TEST_CHECK(!hd44780_write_float(handle, 9.99f, 1));
+	TEST_CHECK(_test_row_is(handle, 0, 0, "10.0 "));
+
+	/* Precision 0 has no decimal point and no terminating NUL is sent */
+	hd44780_gotoxy(handle, 0, 1);
+	TEST_CHECK(!hd44780_write_float(handle, -2.25f, 0));
+	TEST_CHECK(_test_row_is(handle, 0, 1, "-2 "));
+
+	hd44780_gotoxy(handle, 0, 2);
+	TEST_CHECK(!hd44780_write_float(handle, -0.125f, 3));
+	TEST_CHECK(_test_row_is(handle, 0, 2, "-0.125 "));
+
+	hd44780_destroy(handle);
+}
+
+static void test_format_number(void)
+{
+	hd44780_number_t num = {.width = 6, .align = HD44780_ALIGN_RIGHT, .precision = 1};
+	uint8_t text[LCD_DDRAM_LINE_SIZE];
+
+	_format_number(&num, 1234, text);
+	TEST_CHECK(!memcmp(text, " 123.4", 6));
+
+	_format_number(&num, -5, text);
+	TEST_CHECK(!memcmp(text, "  -0.5", 6));
+
+	num.align = HD44780_ALIGN_LEFT;
+	num.precision = 0;
+	_format_number(&num, 42, text);
+	TEST_CHECK(!memcmp(text, "42    ", 6));
+
+	_format_number(&num, INT32_MIN, text);
+	TEST_CHECK(!memcmp(text, "######", 6));
+
+	_format_number(&num, -99999, text);
+	TEST_CHECK(!memcmp(text, "-99999", 6));
+
+	_format_number(&num, 1000000, text);
+	TEST_CHECK(!memcmp(text, "######", 6));
+}
+
+static void test_number_write(void)
+{
+	hd44780_handle_t handle = _test_init(HD44780_SIZE_16_2);
+	vlcd_ctrl_t *lcd = &vlcd_i2c[I2C_NUM_1].ctrl[0];
+	hd44780_number_t num = {.col = 4, .row = 1, .width = 7, .align = HD44780_ALIGN_RIGHT, .precision = 2};
+
+	TEST_CHECK(handle);
+	TEST_CHECK(!hd44780_number_write(handle, &num, 12345));
+	TEST_CHECK(_test_lcd_row_is(handle, 4, 1, " 123.45"));
+
+	/* Last digit changes, one address instruction and one data write */
+	uint32_t num_cmd = lcd->num_cmd, num_data = lcd->num_data;
+	TEST_CHECK(!hd44780_number_write(handle, &num, 12346));
+	TEST_CHECK((lcd->num_cmd - num_cmd == 1) && (lcd->num_data - num_data == 1));
+	TEST_CHECK(_test_lcd_row_is(handle, 4, 1, " 123.46"));
+
+	/* Same value sends nothing */
+	num_cmd = lcd->num_cmd;
+	num_data = lcd->num_data;
+	TEST_CHECK(!hd44780_number_write(handle, &num, 12346));
+	TEST_CHECK((lcd->num_cmd == num_cmd) && (lcd->num_data == num_data));
+
+	/* Too wide for field */
+	TEST_CHECK(!hd44780_number_write(handle, &num, -1000000));
+	TEST_CHECK(_test_lcd_row_is(handle, 4, 1, "#######"));
+
+	TEST_CHECK(!hd44780_number_write_float(handle, &num, -3.14159f));
+	TEST_CHECK(_test_lcd_row_is(handle, 4, 1, "  -3.14"));
+	TEST_CHECK(_test_lcd_matches(handle));
+
+	hd44780_destroy(handle);
+}
+
+static void test_page(void)
+{
+	hd44780_handle_t handle = _test_init(HD44780_SIZE_16_2);
+	vlcd_ctrl_t *lcd = &vlcd_i2c[I2C_NUM_1].ctrl[0];
+	uint8_t buf_a[HD44780_PAGE_SIZE(HD44780_SIZE_16_2)], buf_b[HD44780_PAGE_SIZE(HD44780_SIZE_16_2)];
+	hd44780_page_t page_a, page_b;
+
+	TEST_CHECK(handle);
+	TEST_CHECK(hd44780_page_init(handle, &page_a, buf_a, sizeof(buf_a) - 1));
+	TEST_CHECK(!hd44780_page_init(handle, &page_a, buf_a, sizeof(buf_a)));
+	TEST_CHECK(!hd44780_page_init(handle, &page_b, buf_b, sizeof(buf_b)));
+
+	/* Shared layout, only values differ */
+	hd44780_page_write(handle, &page_a, 0, 0, (const uint8_t *)"Temp:  21.5 C");
+	hd44780_page_write(handle, &page_a, 0, 1, (const uint8_t *)"Page 1");
+	hd44780_page_write(handle, &page_b, 0, 0, (const uint8_t *)"Temp:  19.0 C");
+	hd44780_page_write(handle, &page_b, 0, 1, (const uint8_t *)"Page 2");
+
+	TEST_CHECK(!hd44780_page_show(handle, &page_a));
+	TEST_CHECK(_test_lcd_row_is(handle, 0, 0, "Temp:  21.5 C") && _test_lcd_row_is(handle, 0, 1, "Page 1"));
+
+	/* Switching sends only the cells that differ */
+	uint32_t num_data = lcd->num_data;
+	TEST_CHECK(!hd44780_page_show(handle, &page_b));
+	TEST_CHECK(lcd->num_data - num_data <= 5);
+	TEST_CHECK(_test_lcd_row_is(handle, 0, 0, "Temp:  19.0 C") && _test_lcd_row_is(handle, 0, 1, "Page 2"));
+
+	/* Hidden page is updated in RAM only, shown page is sent at once */
+	num_data = lcd->num_data;
+	hd44780_page_write(handle, &page_a, 7, 0, (const uint8_t *)"22.0");
+	TEST_CHECK(lcd->num_data == num_data);
+	hd44780_page_write(handle, &page_b, 7, 0, (const uint8_t *)"18.5");
+	TEST_CHECK(_test_lcd_row_is(handle, 0, 0, "Temp:  18.5 C"));
+	TEST_CHECK(!hd44780_page_show(handle, &page_a));
+	TEST_CHECK(_test_lcd_row_is(handle, 0, 0, "Temp:  22.0 C") && _test_lcd_row_is(handle, 0, 1, "Page 1"));
+	TEST_CHECK(_test_lcd_matches(handle));
+
+	hd44780_destroy(handle);
+}
+
+static void test_resync(void)
+{
+	hd44780_handle_t handle = _test_init_4bit(HD44780_SIZE_16_2, true);
+	vlcd_ctrl_t *lcd = &vlcd_port[TEST_PORT].ctrl[0];
+	bool resynced;
+
+	TEST_CHECK(handle && _test_lcd_matches(handle));
+
+	/* Address counter is read after it settles, no false alarm over many checks */
+	hd44780_gotoxy(handle, 0, 0);
+	for (int i = 0; i < 10 * LCD_SYNC_CHECK_WRITES; i++) {
+		hd44780_write_char(handle, 'A' + i % 16);
+	}
+	TEST_CHECK(lcd->num_cmd == 8 + 1);
+	uint32_t data_us = lcd->data_us;
+	for (int i = 0; i < 8; i++) {
+		/* Busy flag clears at each point of the polling loop */
+		lcd->data_us = data_us + i;
+		hd44780_write_char(handle, '0' + i);
+		TEST_CHECK(!hd44780_check_sync(handle, &resynced) && !resynced);
+	}
+	lcd->data_us = data_us;
+	TEST_CHECK(_test_lcd_matches(handle));
+
+	/* Writes past their deadline read status only for the periodic check */
+	uint32_t num_read = lcd->num_read;
+	for (int i = 0; i < 2 * LCD_SYNC_CHECK_WRITES; i++) {
+		vlcd_advance_us(2 * timing_default.data_us);
+		hd44780_write_char(handle, 'a');
+	}
+	TEST_CHECK(lcd->num_read - num_read == 2 * 2);
+
+	/* Extra EN pulse puts controller one nibble out of step */
+	hd44780_fb_write(handle, 0, 1, (const uint8_t *)"line two", 8);
+	TEST_CHECK(!hd44780_flush(handle));
+	vlcd_advance_us(timing_default.data_us);
+	vlcd_glitch_en(TEST_PORT, 0);
+	TEST_CHECK(!hd44780_check_sync(handle, &resynced) && resynced);
+	TEST_CHECK(_test_lcd_matches(handle) && _test_lcd_row_is(handle, 0, 1, "line two"));
+
+	/* Periodic check catches it without being asked */
+	vlcd_advance_us(timing_default.data_us);
+	vlcd_glitch_en(TEST_PORT, 0);
+	for (int i = 0; i < LCD_SYNC_CHECK_WRITES; i++) {
+		hd44780_write_char(handle, 'z');
+	}
+	TEST_CHECK(lcd->four_bit && !lcd->half);
+
+	/* Writes out of step overlap execution, only what follows recovery counts */
+	lcd->num_violation = 0;
+	hd44780_gotoxy(handle, 0, 0);
+	hd44780_write_string(handle, (uint8_t *)"ok");
+	TEST_CHECK(_test_lcd_matches(handle) && _test_lcd_row_is(handle, 0, 0, "ok") && _test_lcd_row_is(handle, 0, 1, "line two"));
+
+	hd44780_destroy(handle);
+}
+
+static void test_plan_cost(void)
+{
+	hd44780_handle_t handle = _test_init(HD44780_SIZE_20_4);
+	hd44780_cost_t cost = {.txn_us = 100, .cmd_us = 200, .data_us = 50};
+	hd44780_plan_t plan;
+
+	TEST_CHECK(handle);
+	TEST_CHECK(!hd44780_set_cost(handle, &cost));
+
+	/* Nothing changed since clear */
+	TEST_CHECK(!hd44780_plan_flush(handle, &plan));
+	TEST_CHECK(!plan.num_txn && !plan.num_cmd && !plan.num_data && !plan.cost_us);
+
+	/* Address counter is at (0, 0), one unchanged cell is cheaper to rewrite than to skip */
+	hd44780_fb_write(handle, 0, 0, (const uint8_t *)"AB", 2);
+	hd44780_fb_write(handle, 3, 0, (const uint8_t *)"C", 1);
+	TEST_CHECK(!hd44780_plan_flush(handle, &plan));
+	TEST_CHECK((plan.num_cmd == 0) && (plan.num_data == 4) && (plan.num_bridged == 1));
+	TEST_CHECK((plan.num_txn == 1) && (plan.cost_us == 100 + 4 * 50));
+
+	/* Five unchanged cells cost more than a set DDRAM address */
+	hd44780_fb_write(handle, 9, 0, (const uint8_t *)"D", 1);
+	TEST_CHECK(!hd44780_plan_flush(handle, &plan));
+	TEST_CHECK((plan.num_cmd == 1) && (plan.num_data == 5) && (plan.num_bridged == 1));
+
+	/* Flush sends the plan, nothing is left afterwards */
+	TEST_CHECK(!hd44780_flush(handle));
+	TEST_CHECK(!hd44780_plan_flush(handle, &plan));
+	TEST_CHECK(!plan.num_cmd && !plan.num_data);
+
+	hd44780_destroy(handle);
+}
+
+static void test_plan_sweep(void)
+{
+	hd44780_handle_t handle = _test_init(HD44780_SIZE_20_4);
+	hd44780_cost_t cost = {.txn_us = 100, .cmd_us = 200, .data_us = 50};
+	hd44780_plan_t plan;
+
+	TEST_CHECK(handle);
+	hd44780_set_cost(handle, &cost);
+
+	/* Row 0 runs on into row 2 in DDRAM, one address instruction for both cells */
+	hd44780_fb_write(handle, 19, 0, (const uint8_t *)"A", 1);
+	hd44780_fb_write(handle, 0, 2, (const uint8_t *)"B", 1);
+	TEST_CHECK(!hd44780_plan_flush(handle, &plan));
+	TEST_CHECK((plan.num_cmd == 1) && (plan.num_data == 2) && !plan.num_bridged);
+
+	/* Sweep starts at address counter and wraps, cell before it costs no extra instruction */
+	TEST_CHECK(!hd44780_flush(handle));
+	hd44780_fb_write(handle, 1, 2, (const uint8_t *)"C", 1);
+	hd44780_fb_write(handle, 0, 0, (const uint8_t *)"D", 1);
+	TEST_CHECK(!hd44780_plan_flush(handle, &plan));
+	TEST_CHECK((plan.num_cmd == 1) && (plan.num_data == 2));
+
+	TEST_CHECK(!hd44780_flush(handle));
+	TEST_CHECK(_test_row_is(handle, 0, 0, "D") && _test_row_is(handle, 19, 0, "A") && _test_row_is(handle, 0, 2, "BC"));
+
+	hd44780_destroy(handle);
+}
+
+static void test_plan_actual(void)
+{
+	hd44780_handle_t handle = _test_init(HD44780_SIZE_20_4);
+	vlcd_t *vlcd = &vlcd_i2c[I2C_NUM_1];
+	hd44780_plan_t plan;
+
+	TEST_CHECK(handle);
+
+	/* Scattered changes, planned writes are the writes sent */
+	hd44780_fb_write(handle, 2, 0, (const uint8_t *)"ab", 2);
+	hd44780_fb_write(handle, 6, 0, (const uint8_t *)"c", 1);
+	hd44780_fb_write(handle, 15, 1, (const uint8_t *)"defg", 4);
+	hd44780_fb_write(handle, 0, 3, (const uint8_t *)"h", 1);
+	hd44780_fb_write(handle, 19, 2, (const uint8_t *)"i", 1);
+	TEST_CHECK(!hd44780_plan_flush(handle, &plan));
+
+	uint32_t num_cmd = vlcd->ctrl[0].num_cmd, num_data = vlcd->ctrl[0].num_data, num_txn = vlcd->num_txn;
+	TEST_CHECK(!hd44780_flush(handle));
+	TEST_CHECK(vlcd->ctrl[0].num_cmd - num_cmd == plan.num_cmd);
+	TEST_CHECK(vlcd->ctrl[0].num_data - num_data == plan.num_data);
+	TEST_CHECK(vlcd->num_txn - num_txn == plan.num_txn);
+	TEST_CHECK(plan.num_data >= 9);
+	TEST_CHECK(_test_lcd_matches(handle));
+
+	hd44780_destroy(handle);
+}
+
+#ifndef HD44780_SINGLE_OWNER
+static void test_group(void)
+{
+	hd44780_cfg_t cfg[3] = {
+		_test_cfg_serial(HD44780_SIZE_16_2, I2C_NUM_1),
+		_test_cfg_serial(HD44780_SIZE_20_4, I2C_NUM_2),
+		_test_cfg_4bit(HD44780_SIZE_40_4, 1, true),
+	};
+	hd44780_handle_t handles[3];
+	uint32_t done_us[3];
+
+	vlcd_reset();
+	for (int i = 0; i < 3; i++) {
+		handles[i] = hd44780_init(&cfg[i]);
+		TEST_CHECK(handles[i]);
+	}
+
+	hd44780_group_cfg_t group_cfg = {.handles = handles, .num_handle = 3, .priority = 1};
+	hd44780_group_handle_t group = hd44780_group_create(&group_cfg);
+	TEST_CHECK(group);
+
+	/* Each bus worker flushes its panel, all in step with their controllers */
+	for (int round = 0; round < 3; round++) {
+		uint32_t start = vlcd_time_us();
+		for (int i = 0; i < 3; i++) {
+			char text[16];
+			snprintf(text, sizeof(text), "panel %d round %d", i, round);
+			hd44780_fb_write(handles[i], 0, 1, (const uint8_t *)text, strlen(text));
+		}
+		TEST_CHECK(!hd44780_group_commit(group));
+		TEST_CHECK(!hd44780_group_join(group, done_us));
+		for (int i = 0; i < 3; i++) {
+			TEST_CHECK((int32_t)(done_us[i] - start) > 0);
+			TEST_CHECK(_test_lcd_matches(handles[i]));
+		}
+	}
+	TEST_CHECK(_test_lcd_row_is(handles[2], 0, 1, "panel 2 round 2"));
+
+	/* Join without commit is refused */
+	TEST_CHECK(hd44780_group_join(group, NULL));
+
+	hd44780_group_destroy(group);
+	for (int i = 0; i < 3; i++) {
+		hd44780_destroy(handles[i]);
+	}
+}
+#endif
+
+HD44780_TEMPLATE(test_tpl, HD44780_SIZE_16_2,
+	HD44780_TEMPLATE_TEXT(0, 0, "Temp:"),
+	HD44780_TEMPLATE_TEXT(11, 0, "\xDF" "C"),
+	HD44780_TEMPLATE_TEXT(0, 1, "Hum:"),
+	HD44780_TEMPLATE_TEXT(12, 1, "%"));
+
+static void test_template(void)
+{
+	hd44780_handle_t handle = _test_init(HD44780_SIZE_16_2);
+	vlcd_ctrl_t *lcd = &vlcd_i2c[I2C_NUM_1].ctrl[0];
+
+	TEST_CHECK(handle);
+
+	/* First run starts at (0, 0) right after clear, others need an address */
+	uint32_t num_cmd = lcd->num_cmd, num_data = lcd->num_data;
+	TEST_CHECK(!hd44780_template_apply(handle, &test_tpl, false));
+	TEST_CHECK((lcd->num_cmd - num_cmd == 3) && (lcd->num_data - num_data == 5 + 2 + 4 + 1));
+	TEST_CHECK(_test_lcd_row_is(handle, 0, 0, "Temp:      \xDF" "C") && _test_lcd_row_is(handle, 0, 1, "Hum:        %"));
+
+	/* Values written between runs are kept, diff of unchanged layout sends nothing */
+	hd44780_fb_write(handle, 6, 0, (const uint8_t *)"21.5", 4);
+	TEST_CHECK(!hd44780_flush(handle));
+	num_data = lcd->num_data;
+	TEST_CHECK(!hd44780_template_apply(handle, &test_tpl, true));
+	TEST_CHECK(lcd->num_data == num_data);
+	TEST_CHECK(_test_lcd_row_is(handle, 0, 0, "Temp: 21.5 \xDF" "C"));
+
+	/* Damaged layout cell is repaired by diff */
+	hd44780_fb_write(handle, 0, 1, (const uint8_t *)"X", 1);
+	TEST_CHECK(!hd44780_flush(handle));
+	num_data = lcd->num_data;
+	TEST_CHECK(!hd44780_template_apply(handle, &test_tpl, true));
+	TEST_CHECK(lcd->num_data - num_data == 1);
+	TEST_CHECK(_test_lcd_row_is(handle, 0, 1, "Hum:") && _test_lcd_matches(handle));
+
+	/* Template made for another size is refused */
+	hd44780_destroy(handle);
+	handle = _test_init(HD44780_SIZE_20_4);
+	TEST_CHECK(handle && hd44780_template_apply(handle, &test_tpl, false));
+	hd44780_destroy(handle);
+}
+
+static void test_console(void)
+{
+	hd44780_handle_t handle = _test_init(HD44780_SIZE_16_2);
+	hd44780_console_t console;
+	uint8_t buf[64];
+
+	TEST_CHECK(handle);
+	TEST_CHECK(!hd44780_console_init(&console, buf, sizeof(buf)));
+
+	/* Text on screen before console starts */
+	hd44780_fb_write(handle, 0, 0, (const uint8_t *)"################", 16);
+	hd44780_fb_write(handle, 0, 1, (const uint8_t *)"################", 16);
+	TEST_CHECK(!hd44780_flush(handle));
+
+	/* Newline blanks what is left of the line, control characters do not reach CGRAM */
+	TEST_CHECK(!hd44780_console_write(&console, (const uint8_t *)"hello\rHE\n", 9));
+	TEST_CHECK(!hd44780_console_write(&console, (const uint8_t *)"x\x07y\x00", 4));
+	TEST_CHECK(!hd44780_console_render(handle, &console));
+	TEST_CHECK(_test_lcd_row_is(handle, 0, 0, "HE              "));
+	TEST_CHECK(_test_lcd_row_is(handle, 0, 1, "x?y?############"));
+	TEST_CHECK(_test_lcd_matches(handle));
+
+	/* Tab, backspace and scroll, rows move up in frame buffer */
+	TEST_CHECK(!hd44780_console_write(&console, (const uint8_t *)"\n\tab\bc", 6));
+	TEST_CHECK(!hd44780_console_render(handle, &console));
+	TEST_CHECK(_test_lcd_row_is(handle, 0, 0, "x?y?            "));
+	TEST_CHECK(_test_lcd_row_is(handle, 0, 1, "    ac          "));
+	TEST_CHECK(_test_lcd_matches(handle));
+
+	/* Full row followed by newline is one line */
+	TEST_CHECK(!hd44780_console_write(&console, (const uint8_t *)"\r0123456789abcdef\nend", 21));
+	TEST_CHECK(!hd44780_console_render(handle, &console));
+	TEST_CHECK(_test_lcd_row_is(handle, 0, 0, "0123456789abcdef"));
+	TEST_CHECK(_test_lcd_row_is(handle, 0, 1, "end             "));
+	TEST_CHECK(_test_lcd_matches(handle));
+
+	/* Write not fitting in ring buffer is dropped whole */
+	uint8_t big[sizeof(buf)];
+	memset(big, 'z', sizeof(big));
+	TEST_CHECK(!hd44780_console_write(&console, big, sizeof(big)) && (console.dropped == sizeof(big)));
+
+	hd44780_destroy(handle);
+}
+
+static void test_widget(void)
+{
+	hd44780_handle_t handle = _test_init(HD44780_SIZE_20_4);
+	vlcd_ctrl_t *lcd = &vlcd_i2c[I2C_NUM_1].ctrl[0];
+	hd44780_bar_t bar = {.col = 0, .row = 0, .len = 10, .dir = HD44780_BAR_HORIZONTAL};
+	hd44780_number_t big = {.col = 0, .row = 2, .width = 4};
+
+	TEST_CHECK(handle);
+
+	/* Glyphs are loaded once, then one pixel step is one data write */
+	TEST_CHECK(!hd44780_widget_preload(handle, HD44780_WIDGET_HBAR | HD44780_WIDGET_BIG_NUMBER));
+	TEST_CHECK(!hd44780_bar_write(handle, &bar, 23, 50));
+	uint32_t num_data = lcd->num_data;
+	TEST_CHECK(!hd44780_bar_write(handle, &bar, 24, 50));
+	TEST_CHECK(lcd->num_data - num_data == 1);
+	TEST_CHECK(_test_lcd_matches(handle));
+
+	/* Big digits reuse the same glyph set, no CGRAM write */
+	uint8_t cgram[sizeof(handle->cgram)];
+	memcpy(cgram, lcd->cgram, sizeof(cgram));
+	TEST_CHECK(!hd44780_big_number_write(handle, &big, 1234));
+	TEST_CHECK(!hd44780_big_number_write(handle, &big, -56));
+	TEST_CHECK(!memcmp(cgram, lcd->cgram, sizeof(cgram)));
+	TEST_CHECK(_test_lcd_matches(handle));
+
+	/* Clear keeps widget glyphs loaded, release frees them */
+	TEST_CHECK(!hd44780_clear(handle));
+	num_data = lcd->num_data;
+	TEST_CHECK(!hd44780_bar_write(handle, &bar, 50, 50));
+	TEST_CHECK(lcd->num_data - num_data == 10);
+	TEST_CHECK(!hd44780_widget_release(handle));
+	for (uint8_t slot = 0; slot < LCD_NUM_CGRAM_SLOT; slot++) {
+		TEST_CHECK(handle->cgram_kind[slot] == CGRAM_KIND_FREE);
+	}
+	hd44780_destroy(handle);
+
+	/* No slot left for partial cell, LCD is left as it was */
+	handle = _test_init(HD44780_SIZE_20_4);
+	TEST_CHECK(handle);
+	static const uint8_t dot[8] = {0, 0, 0, 0x04, 0, 0, 0, 0};
+	for (uint8_t slot = 0; slot < LCD_NUM_CGRAM_SLOT; slot++) {
+		TEST_CHECK(!hd44780_load_custom_char(handle, slot, dot));
+	}
+	hd44780_bar_t vbar = {.col = 5, .row = 3, .len = 2, .dir = HD44780_BAR_VERTICAL};
+	hd44780_fb_write(handle, 5, 2, (const uint8_t *)"v", 1);
+	TEST_CHECK(!hd44780_flush(handle));
+	num_data = lcd->num_data;
+	TEST_CHECK(hd44780_bar_write(handle, &vbar, 12, 16));
+	TEST_CHECK(_test_row_is(handle, 5, 2, "v") && _test_row_is(handle, 5, 3, " "));
+	TEST_CHECK(lcd->num_data == num_data);
+	TEST_CHECK(_test_lcd_matches(handle));
+	hd44780_destroy(handle);
+}
+
+static void test_anim(void)
+{
+	static const uint8_t frames[3 * 8] = {
+		0x04, 0x04, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x1C, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x04, 0x04, 0x04, 0x00, 0x00,
+	};
+	static const hd44780_anim_t spin = {frames, 3, 2};
+	hd44780_handle_t handle = _test_init(HD44780_SIZE_16_2);
+	vlcd_ctrl_t *lcd = &vlcd_i2c[I2C_NUM_1].ctrl[0];
+	hd44780_animator_t animator = {0};
+
+	TEST_CHECK(handle);
+	TEST_CHECK(!hd44780_anim_start(handle, &animator, 5, &spin));
+	TEST_CHECK(!memcmp(&lcd->cgram[5 * 8], &frames[0], 8));
+	hd44780_gotoxy(handle, 0, 0);
+	hd44780_write_string(handle, (uint8_t *)"\x05 \x05 \x05");
+
+	/* Frame changes every two ticks, only CGRAM of the slot is written */
+	uint8_t ddram[sizeof(lcd->ddram)];
+	memcpy(ddram, lcd->ddram, sizeof(ddram));
+	uint32_t num_data = lcd->num_data;
+	TEST_CHECK(!hd44780_anim_tick(handle, &animator));
+	TEST_CHECK(lcd->num_data == num_data);
+	TEST_CHECK(!hd44780_anim_tick(handle, &animator));
+	TEST_CHECK(lcd->num_data - num_data == 8);
+	TEST_CHECK(!memcmp(&lcd->cgram[5 * 8], &frames[8], 8));
+	TEST_CHECK(!memcmp(ddram, lcd->ddram, sizeof(ddram)));
+	TEST_CHECK(_test_lcd_matches(handle));
+
+	/* Direct writes continue where they left off */
+	hd44780_write_char(handle, '!');
+	TEST_CHECK(_test_lcd_row_is(handle, 0, 0, "\x05 \x05 \x05!"));
+
+	/* Last frame wraps to first, stopped slot keeps its frame */
+	for (int i = 0; i < 4; i++) {
+		TEST_CHECK(!hd44780_anim_tick(handle, &animator));
+	}
+	TEST_CHECK(!memcmp(&lcd->cgram[5 * 8], &frames[0], 8));
+	TEST_CHECK(!hd44780_anim_stop(handle, &animator, 5));
+	num_data = lcd->num_data;
+	for (int i = 0; i < 4; i++) {
+		TEST_CHECK(!hd44780_anim_tick(handle, &animator));
+	}
+	TEST_CHECK(lcd->num_data == num_data);
+
+	/* Slot holding a widget glyph is refused */
+	TEST_CHECK(!hd44780_widget_preload(handle, HD44780_WIDGET_HBAR));
+	TEST_CHECK(handle->cgram_kind[0] == CGRAM_KIND_WIDGET);
+	TEST_CHECK(hd44780_anim_start(handle, &animator, 0, &spin));
+	TEST_CHECK(_test_lcd_matches(handle));
+
+	hd44780_destroy(handle);
+}
+
+static void test_bus_hold(void)
+{
+	hd44780_cfg_t cfg = _test_cfg_serial(HD44780_SIZE_20_4, I2C_NUM_1);
+	vlcd_t *vlcd = &vlcd_i2c[I2C_NUM_1];
+	uint32_t worst_us;
+
+	cfg.hw_info.i2c_speed = 100000;
+	vlcd_reset();
+	hd44780_handle_t handle = hd44780_init(&cfg);
+	TEST_CHECK(handle);
+
+	/* One batched flush is one long transfer without limit */
+	for (uint8_t row = 0; row < 4; row++) {
+		hd44780_fb_write(handle, 0, row, (const uint8_t *)"12345678901234567890", 20);
+	}
+	TEST_CHECK(!hd44780_flush(handle));
+	TEST_CHECK(vlcd->max_txn_len == LCD_BATCH_SIZE);
+
+	/* 90 us per byte at 100 kHz, 1 ms holds 11 bytes minus start and stop, rounded down to nibble */
+	TEST_CHECK(!hd44780_set_bus_hold(handle, 1000));
+	TEST_CHECK(!hd44780_get_bus_hold(handle, &worst_us) && !worst_us);
+	vlcd->max_txn_len = 0;
+	for (uint8_t row = 0; row < 4; row++) {
+		hd44780_fb_write(handle, 0, row, (const uint8_t *)"abcdefghijklmnopqrst", 20);
+	}
+	TEST_CHECK(!hd44780_flush(handle));
+	TEST_CHECK(vlcd->max_txn_len == 8);
+	TEST_CHECK(!hd44780_get_bus_hold(handle, &worst_us) && worst_us && (worst_us <= 1000));
+	TEST_CHECK(_test_lcd_matches(handle) && _test_lcd_row_is(handle, 0, 3, "abcdefghijklmnopqrst"));
+
+	/* Limit below one nibble still sends whole nibbles */
+	TEST_CHECK(!hd44780_set_bus_hold(handle, 1));
+	vlcd->max_txn_len = 0;
+	hd44780_gotoxy(handle, 0, 0);
+	hd44780_write_string(handle, (uint8_t *)"nibble");
+	TEST_CHECK(vlcd->max_txn_len == 2);
+	TEST_CHECK(_test_lcd_matches(handle) && _test_lcd_row_is(handle, 0, 0, "nibble"));
+
+	hd44780_destroy(handle);
+}
+
+static void test_display_off(void)
+{
+	hd44780_handle_t handle = _test_init(HD44780_SIZE_16_2);
+	vlcd_t *vlcd = &vlcd_i2c[I2C_NUM_1];
+	static const uint8_t arrow[8] = {0x00, 0x04, 0x02, 0x1F, 0x02, 0x04, 0x00, 0x00};
+
+	TEST_CHECK(handle);
+	hd44780_write_string(handle, (uint8_t *)"before");
+	TEST_CHECK(!hd44780_set_display(handle, false));
+	TEST_CHECK(!vlcd->ctrl[0].display_on);
+
+	/* Nothing is sent while off, RAM state follows */
+	uint32_t num_byte = vlcd->num_byte;
+	hd44780_gotoxy(handle, 0, 1);
+	hd44780_write_string(handle, (uint8_t *)"while off");
+	hd44780_fb_write(handle, 10, 0, (const uint8_t *)"fb", 2);
+	TEST_CHECK(!hd44780_flush(handle));
+	TEST_CHECK(!hd44780_load_custom_char(handle, 2, arrow));
+	TEST_CHECK(vlcd->num_byte == num_byte);
+	TEST_CHECK(_test_lcd_matches(handle));
+
+	/* Wake sends differences, then turns display on */
+	TEST_CHECK(!hd44780_set_display(handle, true));
+	TEST_CHECK(vlcd->ctrl[0].display_on);
+	TEST_CHECK(_test_lcd_row_is(handle, 0, 0, "before    fb") && _test_lcd_row_is(handle, 0, 1, "while off"));
+	TEST_CHECK(!memcmp(&vlcd->ctrl[0].cgram[2 * 8], arrow, 8));
+	TEST_CHECK(_test_lcd_matches(handle));
+
+	/* Direct writes continue at the address left while off */
+	hd44780_write_char(handle, '!');
+	TEST_CHECK(_test_lcd_row_is(handle, 0, 1, "while off!"));
+
+	/* Backlight is an expander output carried by every byte */
+	TEST_CHECK(vlcd->backlight);
+	TEST_CHECK(!hd44780_set_backlight(handle, false));
+	TEST_CHECK(!vlcd->backlight);
+	hd44780_write_char(handle, '?');
+	TEST_CHECK(!vlcd->backlight);
+	TEST_CHECK(!hd44780_set_backlight(handle, true));
+	TEST_CHECK(vlcd->backlight && _test_lcd_matches(handle));
+
+	hd44780_destroy(handle);
+}
+
+int main(void)
+{
+	test_charset_lookup();
+	test_utf8();
+	test_calibrate();
+	test_trace();
+	test_viewport();
+	test_40x4();
+	test_remain_wrap();
+	test_deadline();
+	test_static();
+	test_field();
+	test_write_int();
+	test_write_float();
+	test_format_number();
+	test_number_write();
+	test_page();
+	test_resync();
+	test_plan_cost();
+	test_plan_sweep();
+	test_plan_actual();
+#ifndef HD44780_SINGLE_OWNER
+	test_group();
+#endif
+	test_template();
+	test_console();
+	test_widget();
+	test_anim();
+	test_bus_hold();
+	test_display_off();
+
+	if (num_fail) {
+		printf("%d checks failed\n", num_fail);
+		return 1;
+	}
+	printf("all checks passed\n");
+
+	return 0;
+}
@@ -0,0 +1,74 @@
+/*
+ * Virtual HD44780 behind the GPIO and I2C stand-ins. Parallel controllers are
+ * wired to one GPIO port each, serial ones sit behind a PCF8574 on an I2C bus.
+ */
+#ifndef _VLCD_H_
+#define _VLCD_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "driver/i2c.h"
+
+#define VLCD_NUM_PORT				4
+#define VLCD_PIN_RS					0
+#define VLCD_PIN_RW					1
+#define VLCD_PIN_EN					2
+#define VLCD_PIN_EN2				3			/* Second controller of 40x4 LCD */
+#define VLCD_PIN_D4					4			/* D4 to D7 on pins 4 to 7 */
+
+#define VLCD_TADD_US				4			/* Address counter settles this long after busy flag clears */
+
+typedef struct {
+	uint8_t 			ddram[80];					/* Line 0x00 then line 0x40 */
+	uint8_t 			cgram[64];
+	uint8_t 			ac;							/* Address counter */
+	bool 				ac_cgram;					/* Address counter points to CGRAM */
+	uint8_t 			ac_old;						/* Read back until address counter settles */
+	bool 				inc;
+	uint8_t 			shift;						/* Same convention as the driver mirror */
+	bool 				display_on;
+	bool 				four_bit;
+	bool 				half;						/* First nibble of a write or read done, reads and writes share it */
+	uint8_t 			high;
+	uint8_t 			read_val;
+	uint32_t 			busy_until;
+	uint32_t 			clear_us;					/* Execution times, may be scripted by tests */
+	uint32_t 			cmd_us;
+	uint32_t 			data_us;
+	uint32_t 			num_cmd;
+	uint32_t 			num_data;
+	uint32_t 			num_read;
+	uint32_t 			num_violation;				/* Writes latched while busy, these are lost */
+} vlcd_ctrl_t;
+
+typedef struct {
+	vlcd_ctrl_t 		ctrl[2];
+	bool 				backlight;
+	uint32_t 			num_byte;					/* Expander bytes received */
+	uint32_t 			num_txn;					/* I2C transactions */
+	uint32_t 			max_txn_len;				/* Longest I2C transaction in bytes */
+} vlcd_t;
+
+extern vlcd_t vlcd_port[VLCD_NUM_PORT];
+extern vlcd_t vlcd_i2c[I2C_NUM_MAX];
+
+/* Power on every virtual controller, clear counters and bus state */
+void vlcd_reset(void);
+
+/* Microsecond clock shared by stand-ins and tests, each read advances it */
+uint32_t vlcd_time_us(void);
+
+/* Advance clock without reading it */
+void vlcd_advance_us(uint32_t us);
+
+/* Move clock to any value, for wrap-around checks */
+void vlcd_set_time_us(uint32_t us);
+
+/* Raise then drop EN of a parallel controller, as noise on the line would */
+void vlcd_glitch_en(int port, int ctrl);
+
+/* Index of address in ddram, -1 outside of DDRAM lines */
+int vlcd_ddram_index(uint8_t addr);
+
+#endif /* _VLCD_H_ */
@@ -0,0 +1,45 @@
+#!/bin/sh
+#
+# Report RAM/flash footprint of the driver for each build profile.
+#
+# Usage:   CC=arm-none-eabi-gcc CFLAGS="-Os -mthumb -mcpu=cortex-m3 -I<stm-idf includes>" tools/footprint.sh
+#
+# Flash is text + data of the driver objects. RAM is the handle structure and
+# frame buffer of one LCD; the mutex of the default profile is allocated by
+# FreeRTOS on top of it. Handle size is read from a symbol the driver only
+# defines when built with HD44780_FOOTPRINT, so it is not part of flash.
+
+CC=${CC:-arm-none-eabi-gcc}
+PREFIX=$(echo "$CC" | sed -n 's/gcc$//p')
+SIZE=${SIZE:-${PREFIX}size}
+NM=${NM:-${PREFIX}nm}
+CFLAGS=${CFLAGS:--Os}
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+cat > "$TMP/ram.c" <<EOC
+#include "hd44780.h"
+uint8_t fb_1_ctrl[HD44780_FB_SIZE(HD44780_SIZE_20_4)];
+uint8_t fb_2_ctrl[HD44780_FB_SIZE(HD44780_SIZE_40_4)];
+EOC
+
+sym_size() {
+	printf "%d" "0x$($NM -S "$1" | awk -v sym="$2" '$4 == sym { print $2 }')"
+}
+
+printf "%-14s %8s %8s %8s %8s\n" profile flash handle "fb 1ctl" "fb 2ctl"
+for profile in default single-owner; do
+	flags="$CFLAGS -I$ROOT/include -I$ROOT"
+	[ "$profile" = single-owner ] && flags="$flags -DHD44780_SINGLE_OWNER"
+
+	for src in hd44780.c hd44780_charset.c; do
+		$CC $flags -c "$ROOT/$src" -o "$TMP/${src%.c}.o" || exit 1
+	done
+	$CC $flags -DHD44780_FOOTPRINT -fno-common -c "$ROOT/hd44780.c" -o "$TMP/footprint.o" || exit 1
+	$CC $flags -c "$TMP/ram.c" -o "$TMP/ram.o" || exit 1
+
+	flash=$($SIZE "$TMP/hd44780.o" "$TMP/hd44780_charset.o" | awk 'NR > 1 { s += $1 + $2 } END { print s }')
+	printf "%-14s %8d %8d %8d %8d\n" "$profile" "$flash" "$(sym_size "$TMP/footprint.o" hd44780_footprint_handle)" \
+		"$(sym_size "$TMP/ram.o" fb_1_ctrl)" "$(sym_size "$TMP/ram.o" fb_2_ctrl)"
+done
@@ -0,0 +1,179 @@
+#!/usr/bin/env python3
+# MIT License
+#
+# Copyright (c) 2020 phonght32
+#
+# Generate hd44780_charset_table.h: collision-free (perfect) hash tables that
+# map Unicode code points to HD44780 character ROM codes and to 5x8 fallback
+# glyphs that are loaded into CGRAM when the ROM has no matching character.
+#
+# Usage: python3 tools/gen_charset_table.py > hd44780_charset_table.h
+
+import sys
+
+# Code points covered by a plain range check in hd44780_charset.c are not
+# listed here (ASCII for both ROMs, half-width katakana for A00, Latin-1 upper
+# half for A02).
+
+ROM_A00 = {
+    0x00A5: 0x5C, 0x2192: 0x7E, 0x2190: 0x7F,
+    0x3002: 0xA1, 0x300C: 0xA2, 0x300D: 0xA3, 0x3001: 0xA4, 0x30FB: 0xA5,
+    0x00B7: 0xA5, 0x30F2: 0xA6, 0x30A1: 0xA7, 0x30A3: 0xA8, 0x30A5: 0xA9,
+    0x30A7: 0xAA, 0x30A9: 0xAB, 0x30E3: 0xAC, 0x30E5: 0xAD, 0x30E7: 0xAE,
+    0x30C3: 0xAF, 0x30FC: 0xB0, 0x30A2: 0xB1, 0x30A4: 0xB2, 0x30A6: 0xB3,
+    0x30A8: 0xB4, 0x30AA: 0xB5, 0x30AB: 0xB6, 0x30AD: 0xB7, 0x30AF: 0xB8,
+    0x30B1: 0xB9, 0x30B3: 0xBA, 0x30B5: 0xBB, 0x30B7: 0xBC, 0x30B9: 0xBD,
+    0x30BB: 0xBE, 0x30BD: 0xBF, 0x30BF: 0xC0, 0x30C1: 0xC1, 0x30C4: 0xC2,
+    0x30C6: 0xC3, 0x30C8: 0xC4, 0x30CA: 0xC5, 0x30CB: 0xC6, 0x30CC: 0xC7,
+    0x30CD: 0xC8, 0x30CE: 0xC9, 0x30CF: 0xCA, 0x30D2: 0xCB, 0x30D5: 0xCC,
+    0x30D8: 0xCD, 0x30DB: 0xCE, 0x30DE: 0xCF, 0x30DF: 0xD0, 0x30E0: 0xD1,
+    0x30E1: 0xD2, 0x30E2: 0xD3, 0x30E4: 0xD4, 0x30E6: 0xD5, 0x30E8: 0xD6,
+    0x30E9: 0xD7, 0x30EA: 0xD8, 0x30EB: 0xD9, 0x30EC: 0xDA, 0x30ED: 0xDB,
+    0x30EF: 0xDC, 0x30F3: 0xDD, 0x309B: 0xDE, 0x309C: 0xDF, 0x00B0: 0xDF,
+    0x03B1: 0xE0, 0x00E4: 0xE1, 0x03B2: 0xE2, 0x00DF: 0xE2, 0x03B5: 0xE3,
+    0x00B5: 0xE4, 0x03BC: 0xE4, 0x03C3: 0xE5, 0x03C1: 0xE6, 0x221A: 0xE8,
+    0x00A2: 0xEC, 0x00A3: 0xED, 0x00F1: 0xEE, 0x00F6: 0xEF, 0x03B8: 0xF2,
+    0x221E: 0xF3, 0x03A9: 0xF4, 0x2126: 0xF4, 0x00FC: 0xF5, 0x03A3: 0xF6,
+    0x03C0: 0xF7, 0x5343: 0xFA, 0x4E07: 0xFB, 0x5186: 0xFC, 0x00F7: 0xFD,
+    0x2588: 0xFF,
+}
+
+ROM_A02 = {
+    0x25B6: 0x10, 0x25C0: 0x11, 0x201C: 0x12, 0x201D: 0x13, 0x25CF: 0x16,
+    0x21B5: 0x17, 0x2191: 0x18, 0x2193: 0x19, 0x2192: 0x1A, 0x2190: 0x1B,
+    0x2264: 0x1C, 0x2265: 0x1D, 0x25B2: 0x1E, 0x25BC: 0x1F, 0x2302: 0x7F,
+    0x0411: 0x80, 0x0414: 0x81, 0x0416: 0x82, 0x0417: 0x83, 0x0418: 0x84,
+    0x0419: 0x85, 0x041B: 0x86, 0x041F: 0x87, 0x0423: 0x88, 0x0426: 0x89,
+    0x0427: 0x8A, 0x0428: 0x8B, 0x0429: 0x8C, 0x042A: 0x8D, 0x042B: 0x8E,
+    0x042D: 0x8F, 0x03B1: 0x90, 0x266A: 0x91, 0x0393: 0x92, 0x03C0: 0x93,
+    0x03A3: 0x94, 0x03C3: 0x95, 0x266C: 0x96, 0x03C4: 0x97, 0x0398: 0x99,
+    0x03A9: 0x9A, 0x2126: 0x9A, 0x03B4: 0x9B, 0x221E: 0x9C, 0x2665: 0x9D,
+    0x03B5: 0x9E, 0x2229: 0x9F,
+}
+
+# 5x8 patterns, top row first, 5 least significant bits used.
+GLYPHS = {
+    0x005C: [0x00, 0x10, 0x08, 0x04, 0x02, 0x01, 0x00, 0x00],  # \
+    0x007E: [0x00, 0x00, 0x08, 0x15, 0x02, 0x00, 0x00, 0x00],  # ~
+    0x00B1: [0x04, 0x04, 0x1F, 0x04, 0x04, 0x00, 0x1F, 0x00],  # plus-minus
+    0x00B2: [0x0C, 0x02, 0x04, 0x08, 0x0E, 0x00, 0x00, 0x00],  # superscript 2
+    0x00B3: [0x0C, 0x02, 0x0C, 0x02, 0x0C, 0x00, 0x00, 0x00],  # superscript 3
+    0x00C4: [0x0A, 0x00, 0x0E, 0x11, 0x1F, 0x11, 0x11, 0x00],  # A diaeresis
+    0x00C5: [0x04, 0x0A, 0x04, 0x0E, 0x11, 0x1F, 0x11, 0x00],  # A ring
+    0x00D6: [0x0A, 0x00, 0x0E, 0x11, 0x11, 0x11, 0x0E, 0x00],  # O diaeresis
+    0x00D8: [0x01, 0x0E, 0x13, 0x15, 0x19, 0x0E, 0x10, 0x00],  # O stroke
+    0x00DC: [0x0A, 0x00, 0x11, 0x11, 0x11, 0x11, 0x0E, 0x00],  # U diaeresis
+    0x00E0: [0x08, 0x04, 0x0E, 0x01, 0x0F, 0x11, 0x0F, 0x00],  # a grave
+    0x00E2: [0x04, 0x0A, 0x0E, 0x01, 0x0F, 0x11, 0x0F, 0x00],  # a circumflex
+    0x00E5: [0x04, 0x0A, 0x04, 0x0E, 0x01, 0x0F, 0x11, 0x0F],  # a ring
+    0x00E6: [0x00, 0x00, 0x1A, 0x05, 0x0F, 0x14, 0x0F, 0x00],  # ae
+    0x00E7: [0x00, 0x0E, 0x10, 0x10, 0x11, 0x0E, 0x04, 0x0C],  # c cedilla
+    0x00E8: [0x08, 0x04, 0x0E, 0x11, 0x1F, 0x10, 0x0E, 0x00],  # e grave
+    0x00E9: [0x02, 0x04, 0x0E, 0x11, 0x1F, 0x10, 0x0E, 0x00],  # e acute
+    0x00EA: [0x04, 0x0A, 0x0E, 0x11, 0x1F, 0x10, 0x0E, 0x00],  # e circumflex
+    0x00F8: [0x00, 0x01, 0x0E, 0x13, 0x15, 0x19, 0x0E, 0x10],  # o stroke
+    0x0394: [0x00, 0x04, 0x04, 0x0A, 0x0A, 0x11, 0x1F, 0x00],  # Delta
+    0x20AC: [0x06, 0x09, 0x1C, 0x08, 0x1C, 0x09, 0x06, 0x00],  # euro
+    0x2191: [0x04, 0x0E, 0x15, 0x04, 0x04, 0x04, 0x04, 0x00],  # up arrow
+    0x2193: [0x04, 0x04, 0x04, 0x04, 0x15, 0x0E, 0x04, 0x00],  # down arrow
+    0x2665: [0x00, 0x0A, 0x1F, 0x1F, 0x0E, 0x04, 0x00, 0x00],  # heart
+    0x2713: [0x00, 0x01, 0x03, 0x16, 0x1C, 0x08, 0x00, 0x00],  # check mark
+}
+
+M32 = 0xFFFFFFFF
+
+
+def bucket_of(cp, gbits):
+    return ((cp * 0x9E3779B1) & M32) >> (32 - gbits)
+
+
+def slot_of(cp, seed, bits):
+    h = ((cp ^ ((seed * 0x85EBCA6B) & M32)) * 0xC2B2AE35) & M32
+    h ^= h >> 15
+    return ((h * 0x27D4EB2F) & M32) >> (32 - bits)
+
+
+def build(keys):
+    """Hash-and-displace: one 8-bit seed per bucket, a 2^bits slot table."""
+    bits = 1
+    while (1 << bits) < len(keys) * 5 // 4 + 1:
+        bits += 1
+    gbits = max(bits - 2, 1)
+    while True:
+        buckets = {}
+        for cp in keys:
+            buckets.setdefault(bucket_of(cp, gbits), []).append(cp)
+        seeds = [0] * (1 << gbits)
+        used = {}
+        ok = True
+        for b in sorted(buckets, key=lambda b: -len(buckets[b])):
+            for seed in range(256):
+                slots = [slot_of(cp, seed, bits) for cp in buckets[b]]
+                if len(set(slots)) == len(slots) and not any(s in used for s in slots):
+                    for cp, s in zip(buckets[b], slots):
+                        used[s] = cp
+                    seeds[b] = seed
+                    break
+            else:
+                ok = False
+                break
+        if ok:
+            return bits, gbits, seeds, used
+        bits += 1
+        gbits = max(bits - 2, 1)
+
+
+def emit_seeds(out, name, seeds):
+    out.append("static const uint8_t %s[%d] = {" % (name, len(seeds)))
+    for i in range(0, len(seeds), 16):
+        out.append("\t" + " ".join("%d," % s for s in seeds[i:i + 16]))
+    out.append("};")
+    out.append("")
+
+
+def emit_rom(out, prefix, table):
+    bits, gbits, seeds, used = build(list(table))
+    out.append("#define %s_BITS\t\t%d" % (prefix.upper(), bits))
+    out.append("#define %s_GBITS\t\t%d" % (prefix.upper(), gbits))
+    out.append("")
+    emit_seeds(out, prefix + "_seed", seeds)
+    out.append("static const hd44780_rom_entry_t %s_entry[%d] = {" % (prefix, 1 << bits))
+    for s in range(1 << bits):
+        cp = used.get(s, 0)
+        out.append("\t{0x%04X, 0x%02X}," % (cp, table.get(cp, 0)))
+    out.append("};")
+    out.append("")
+
+
+def emit_glyphs(out, prefix, table):
+    bits, gbits, seeds, used = build(list(table))
+    out.append("#define %s_BITS\t\t%d" % (prefix.upper(), bits))
+    out.append("#define %s_GBITS\t\t%d" % (prefix.upper(), gbits))
+    out.append("")
+    emit_seeds(out, prefix + "_seed", seeds)
+    out.append("static const hd44780_glyph_entry_t %s_entry[%d] = {" % (prefix, 1 << bits))
+    for s in range(1 << bits):
+        cp = used.get(s, 0)
+        pat = table.get(cp, [0] * 8)
+        out.append("\t{0x%04X, {%s}}," % (cp, ", ".join("0x%02X" % p for p in pat)))
+    out.append("};")
+    out.append("")
+
+
+def main():
+    out = [
+        "/* Generated by tools/gen_charset_table.py, do not edit. */",
+        "",
+        "#ifndef _HD44780_CHARSET_TABLE_H_",
+        "#define _HD44780_CHARSET_TABLE_H_",
+        "",
+    ]
+    emit_rom(out, "rom_a00", ROM_A00)
+    emit_rom(out, "rom_a02", ROM_A02)
+    emit_glyphs(out, "glyph", GLYPHS)
+    out.append("#endif /* _HD44780_CHARSET_TABLE_H_ */")
+    sys.stdout.write("\n".join(out) + "\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,109 @@
+#!/usr/bin/env python3
+# MIT License
+#
+# Copyright (c) 2020 phonght32
+#
+# Generate a screen template header from an UTF-8 layout file. Each line of
+# the layout is one LCD row, text is translated to character ROM codes at
+# build time so hd44780_template_apply has nothing to format at runtime.
+# Runs that continue in DDRAM (20x4 row 0 into row 2) are emitted one after
+# another so the address counter carries on without instruction. The first
+# run still costs a set DDRAM address unless the counter already points there.
+#
+# Usage: python3 tools/gen_template.py NAME SIZE CHARSET layout.txt > name.h
+#        SIZE is 16x2, 16x4, 20x4 or 40x4, CHARSET is A00 or A02.
+
+import os
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from gen_charset_table import ROM_A00, ROM_A02
+
+SIZES = {
+    "16x2": ("HD44780_SIZE_16_2", 16, 2, [0, 1]),
+    "16x4": ("HD44780_SIZE_16_4", 16, 4, [0, 2, 1, 3]),
+    "20x4": ("HD44780_SIZE_20_4", 20, 4, [0, 2, 1, 3]),
+    "40x4": ("HD44780_SIZE_40_4", 40, 4, [0, 1, 2, 3]),
+}
+
+
+def rom_code(charset, ch):
+    cp = ord(ch)
+    # Same range checks as hd44780_charset_lookup
+    if charset == "A00":
+        if 0x20 <= cp <= 0x7D and cp != 0x5C:
+            return cp
+        if 0xFF61 <= cp <= 0xFF9F:
+            return cp - 0xFF61 + 0xA1
+        return ROM_A00.get(cp)
+    if 0x20 <= cp <= 0x7E or 0xA0 <= cp <= 0xFF:
+        return cp
+    return ROM_A02.get(cp)
+
+
+def c_string(codes):
+    # Escaped byte ends the literal so a following hex digit is not absorbed,
+    # quote, question mark (trigraphs) and backslash are escaped too
+    parts, cur = [], ""
+    for c in codes:
+        if 0x20 <= c <= 0x7E and c not in (0x22, 0x3F, 0x5C):
+            cur += chr(c)
+        else:
+            cur += "\\x%02X" % c
+            parts.append(cur)
+            cur = ""
+    if cur or not parts:
+        parts.append(cur)
+    return " ".join('"%s"' % p for p in parts)
+
+
+def main():
+    if len(sys.argv) != 5 or sys.argv[2] not in SIZES or sys.argv[3] not in ("A00", "A02"):
+        sys.stderr.write("usage: gen_template.py NAME SIZE CHARSET layout.txt\n")
+        sys.exit(1)
+
+    name, size, charset, path = sys.argv[1:]
+    enum, cols, rows, order = SIZES[size]
+
+    with open(path, encoding="utf-8") as f:
+        lines = f.read().split("\n")
+    if lines and lines[-1] == "":
+        lines.pop()
+    if len(lines) > rows:
+        sys.stderr.write("%s: %d rows, LCD has %d\n" % (path, len(lines), rows))
+        sys.exit(1)
+
+    runs = []
+    for row in order:
+        text = lines[row] if row < len(lines) else ""
+        if len(text) > cols:
+            sys.stderr.write("%s:%d: %d columns, LCD has %d\n" % (path, row + 1, len(text), cols))
+            sys.exit(1)
+        codes = []
+        for col, ch in enumerate(text.ljust(cols)):
+            code = rom_code(charset, ch)
+            if code is None:
+                sys.stderr.write("%s:%d:%d: U+%04X not in character ROM %s\n" % (path, row + 1, col + 1, ord(ch), charset))
+                sys.exit(1)
+            codes.append(code)
+        runs.append("\tHD44780_TEMPLATE_TEXT(0, %d, %s)" % (row, c_string(codes)))
+
+    guard = "_%s_H_" % name.upper()
+    out = [
+        "/* Generated by tools/gen_template.py from %s, do not edit. */" % os.path.basename(path),
+        "",
+        "#ifndef %s" % guard,
+        "#define %s" % guard,
+        "",
+        '#include "hd44780.h"',
+        "",
+        "HD44780_TEMPLATE(%s, %s," % (name, enum),
+        ",\n".join(runs) + ");",
+        "",
+        "#endif /* %s */" % guard,
+    ]
+    sys.stdout.write("\n".join(out) + "\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,397 @@
+// MIT License
+
+// Copyright (c) 2020 phonght32
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/*
+ * Host tool: replay a bus trace recorded by hd44780_trace_start through a
+ * virtual HD44780 controller, render the final screen and report bus usage.
+ *
+ * Build:   cc -O2 -o hd44780_trace tools/hd44780_trace.c
+ * Usage:   hd44780_trace [-x] trace.bin [other.bin]
+ *
+ * Input is hd44780_trace_header_t followed by num_event hd44780_trace_event_t,
+ * little endian, as returned by hd44780_trace_read. With two traces, both are
+ * reported and final screens are compared.
+ *
+ * On 40x4 LCD, events flagged HD44780_TRACE_CTRL_1 are replayed through a
+ * second virtual controller driving rows 2 and 3.
+ *
+ * Screen legend: '*' cell not written since trace start, '.' character outside
+ * printable ASCII (CGRAM or ROM specific code), use -x for codes.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TRACE_MAGIC				0x52544448
+#define TRACE_VERSION			1
+#define TRACE_HEADER_SIZE		16
+#define TRACE_EVENT_SIZE		8
+
+#define TRACE_CMD				0
+#define TRACE_DATA				1
+#define TRACE_WAIT				2
+#define TRACE_CTRL_1			0x80
+
+#define DDRAM_SIZE				0x80
+#define CELL_UNKNOWN			0x100
+#define MAX_CTRL				2
+
+typedef struct {
+	uint32_t 		timestamp_us;
+	uint16_t 		duration_us;
+	uint8_t 		type;
+	uint8_t 		value;
+} event_t;
+
+typedef struct {
+	uint8_t 		size;
+	uint8_t 		comm_mode;
+	uint32_t 		num_event;
+	uint32_t 		num_dropped;
+	event_t 		*events;
+} trace_t;
+
+typedef struct {
+	uint16_t 		ddram[DDRAM_SIZE];
+	uint16_t 		cgram[64];
+	uint8_t 		addr;
+	int 			addr_cgram;
+	int 			increment;
+	int 			shift;
+	int 			display_ctrl;
+	int 			entry_mode;
+} lcd_t;
+
+typedef struct {
+	unsigned long 	num_cmd;
+	unsigned long 	num_data;
+	unsigned long 	num_wait;
+	unsigned long 	redundant_cmd;
+	unsigned long 	redundant_data;
+	uint64_t 		cmd_us;
+	uint64_t 		data_us;
+	uint64_t 		wait_us;
+	uint64_t 		span_us;
+} stats_t;
+
+static const struct {
+	int 			cols;
+	int 			rows;
+	uint8_t 		row_addr[4];
+	uint8_t 		row_ctrl[4];
+} geometry[] = {
+	{16, 2, {0x00, 0x40, 0x10, 0x50}, {0, 0, 0, 0}},
+	{16, 4, {0x00, 0x40, 0x10, 0x50}, {0, 0, 0, 0}},
+	{20, 4, {0x00, 0x40, 0x14, 0x54}, {0, 0, 0, 0}},
+	{40, 4, {0x00, 0x40, 0x00, 0x40}, {0, 0, 1, 1}},
+};
+
+#define NUM_GEOMETRY			(sizeof(geometry) / sizeof(geometry[0]))
+
+static uint32_t get_u32(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static int trace_load(const char *path, trace_t *trace)
+{
+	uint8_t buf[TRACE_HEADER_SIZE];
+	FILE *f = fopen(path, "rb");
+
+	if (f == NULL) {
+		perror(path);
+		return -1;
+	}
+
+	if (fread(buf, 1, TRACE_HEADER_SIZE, f) != TRACE_HEADER_SIZE ||
+	    get_u32(buf) != TRACE_MAGIC || buf[4] != TRACE_VERSION) {
+		fprintf(stderr, "%s: not a trace file\n", path);
+		fclose(f);
+		return -1;
+	}
+
+	trace->size = buf[5];
+	trace->comm_mode = buf[6];
+	trace->num_event = get_u32(&buf[8]);
+	trace->num_dropped = get_u32(&buf[12]);
+	if (trace->size >= NUM_GEOMETRY) {
+		fprintf(stderr, "%s: unknown LCD size %d\n", path, trace->size);
+		fclose(f);
+		return -1;
+	}
+
+	trace->events = calloc(trace->num_event ? trace->num_event : 1, sizeof(event_t));
+	if (trace->events == NULL) {
+		fclose(f);
+		return -1;
+	}
+
+	for (uint32_t i = 0; i < trace->num_event; i++) {
+		uint8_t e[TRACE_EVENT_SIZE];
+		if (fread(e, 1, TRACE_EVENT_SIZE, f) != TRACE_EVENT_SIZE) {
+			fprintf(stderr, "%s: truncated after %u events\n", path, i);
+			trace->num_event = i;
+			break;
+		}
+		trace->events[i].timestamp_us = get_u32(e);
+		trace->events[i].duration_us = e[4] | (e[5] << 8);
+		trace->events[i].type = e[6];
+		trace->events[i].value = e[7];
+	}
+
+	fclose(f);
+	return 0;
+}
+
+static void lcd_reset(lcd_t *lcd)
+{
+	for (int i = 0; i < DDRAM_SIZE; i++)
+		lcd->ddram[i] = CELL_UNKNOWN;
+	for (int i = 0; i < 64; i++)
+		lcd->cgram[i] = CELL_UNKNOWN;
+	lcd->addr = 0;
+	lcd->addr_cgram = 0;
+	lcd->increment = 1;
+	lcd->shift = 0;
+	lcd->display_ctrl = -1;
+	lcd->entry_mode = -1;
+}
+
+static void lcd_move(lcd_t *lcd, int forward)
+{
+	if (lcd->addr_cgram) {
+		lcd->addr = (lcd->addr + (forward ? 1 : 63)) & 0x3F;
+	} else if (forward) {
+		lcd->addr = (lcd->addr == 0x27) ? 0x40 : (lcd->addr == 0x67) ? 0x00 : lcd->addr + 1;
+	} else {
+		lcd->addr = (lcd->addr == 0x40) ? 0x27 : (lcd->addr == 0x00) ? 0x67 : lcd->addr - 1;
+	}
+}
+
+static int lcd_is_blank(lcd_t *lcd)
+{
+	for (int i = 0; i < DDRAM_SIZE; i++) {
+		if (lcd->ddram[i] != ' ')
+			return 0;
+	}
+	return 1;
+}
+
+/* Execute one instruction, return 1 if it did not change controller state */
+static int lcd_cmd(lcd_t *lcd, uint8_t cmd)
+{
+	if (cmd & 0x80) {
+		int same = !lcd->addr_cgram && lcd->addr == (cmd & 0x7F);
+		lcd->addr = cmd & 0x7F;
+		lcd->addr_cgram = 0;
+		return same;
+	} else if (cmd & 0x40) {
+		int same = lcd->addr_cgram && lcd->addr == (cmd & 0x3F);
+		lcd->addr = cmd & 0x3F;
+		lcd->addr_cgram = 1;
+		return same;
+	} else if (cmd & 0x20) {
+		return 0;
+	} else if (cmd & 0x10) {
+		if (cmd & 0x08)
+			lcd->shift = (lcd->shift + ((cmd & 0x04) ? 39 : 1)) % 40;
+		else
+			lcd_move(lcd, cmd & 0x04);
+		return 0;
+	} else if (cmd & 0x08) {
+		int same = lcd->display_ctrl == cmd;
+		lcd->display_ctrl = cmd;
+		return same;
+	} else if (cmd & 0x04) {
+		int same = lcd->entry_mode == cmd;
+		lcd->entry_mode = cmd;
+		lcd->increment = (cmd >> 1) & 1;
+		return same;
+	} else if (cmd & 0x02) {
+		int same = !lcd->addr_cgram && lcd->addr == 0 && lcd->shift == 0;
+		lcd->addr = 0;
+		lcd->addr_cgram = 0;
+		lcd->shift = 0;
+		return same;
+	} else if (cmd & 0x01) {
+		int same = lcd_is_blank(lcd) && !lcd->addr_cgram && lcd->addr == 0 && lcd->shift == 0;
+		for (int i = 0; i < DDRAM_SIZE; i++)
+			lcd->ddram[i] = ' ';
+		lcd->addr = 0;
+		lcd->addr_cgram = 0;
+		lcd->shift = 0;
+		lcd->increment = 1;
+		return same;
+	}
+
+	return 0;
+}
+
+/* Write one data byte, return 1 if memory already held the same value */
+static int lcd_data(lcd_t *lcd, uint8_t data)
+{
+	uint16_t *cell = lcd->addr_cgram ? &lcd->cgram[lcd->addr & 0x3F] : &lcd->ddram[lcd->addr & 0x7F];
+	int same = (*cell == data);
+
+	*cell = data;
+	lcd_move(lcd, lcd->increment);
+
+	return same;
+}
+
+static void replay(const trace_t *trace, lcd_t *lcds, stats_t *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+	for (int i = 0; i < MAX_CTRL; i++)
+		lcd_reset(&lcds[i]);
+
+	for (uint32_t i = 0; i < trace->num_event; i++) {
+		const event_t *e = &trace->events[i];
+		lcd_t *lcd = &lcds[(e->type & TRACE_CTRL_1) ? 1 : 0];
+		int type = e->type & ~TRACE_CTRL_1;
+
+		if (type == TRACE_CMD) {
+			stats->num_cmd++;
+			stats->cmd_us += e->duration_us;
+			stats->redundant_cmd += lcd_cmd(lcd, e->value);
+		} else if (type == TRACE_DATA) {
+			stats->num_data++;
+			stats->data_us += e->duration_us;
+			stats->redundant_data += lcd_data(lcd, e->value);
+		} else if (type == TRACE_WAIT) {
+			stats->num_wait++;
+			stats->wait_us += e->duration_us;
+		}
+	}
+
+	if (trace->num_event) {
+		const event_t *first = &trace->events[0];
+		const event_t *last = &trace->events[trace->num_event - 1];
+		stats->span_us = (uint32_t)(last->timestamp_us - first->timestamp_us) + last->duration_us;
+	}
+}
+
+static void render(const trace_t *trace, const lcd_t *lcds, int hex, char *out)
+{
+	int cols = geometry[trace->size].cols;
+	int rows = geometry[trace->size].rows;
+
+	out += sprintf(out, "+");
+	for (int x = 0; x < cols; x++)
+		out += sprintf(out, "-");
+	out += sprintf(out, "+\n");
+
+	for (int y = 0; y < rows; y++) {
+		uint8_t base = geometry[trace->size].row_addr[y];
+		const lcd_t *lcd = &lcds[geometry[trace->size].row_ctrl[y]];
+		out += sprintf(out, "|");
+		for (int x = 0; x < cols; x++) {
+			/* Display shift only scrolls within a 40 characters line */
+			int col = ((base & 0x3F) + x + lcd->shift) % 40;
+			uint16_t c = lcd->ddram[(base & 0x40) | col];
+			if (c == CELL_UNKNOWN)
+				out += sprintf(out, "*");
+			else if (c >= 0x20 && c < 0x7F)
+				out += sprintf(out, "%c", c);
+			else
+				out += sprintf(out, ".");
+		}
+		out += sprintf(out, "|");
+		if (hex) {
+			for (int x = 0; x < cols; x++) {
+				int col = ((base & 0x3F) + x + lcd->shift) % 40;
+				uint16_t c = lcd->ddram[(base & 0x40) | col];
+				out += (c == CELL_UNKNOWN) ? sprintf(out, " **") : sprintf(out, " %02X", c);
+			}
+		}
+		out += sprintf(out, "\n");
+	}
+
+	out += sprintf(out, "+");
+	for (int x = 0; x < cols; x++)
+		out += sprintf(out, "-");
+	sprintf(out, "+\n");
+}
+
+static void report(const char *path, const trace_t *trace, const stats_t *stats, const char *screen)
+{
+	uint64_t busy = stats->cmd_us + stats->data_us + stats->wait_us;
+
+	printf("%s: %dx%d, %u events, %u dropped before trace\n", path,
+	       geometry[trace->size].cols, geometry[trace->size].rows, trace->num_event, trace->num_dropped);
+	printf("%s", screen);
+	printf("  instructions    %8lu  (%lu redundant)\n", stats->num_cmd, stats->redundant_cmd);
+	printf("  data bytes      %8lu  (%lu redundant)\n", stats->num_data, stats->redundant_data);
+	printf("  waits           %8lu\n", stats->num_wait);
+	printf("  instruction us  %8llu\n", (unsigned long long)stats->cmd_us);
+	printf("  data us         %8llu\n", (unsigned long long)stats->data_us);
+	printf("  wait us         %8llu\n", (unsigned long long)stats->wait_us);
+	printf("  idle us         %8llu\n", (unsigned long long)(stats->span_us > busy ? stats->span_us - busy : 0));
+	printf("  span us         %8llu\n", (unsigned long long)stats->span_us);
+}
+
+int main(int argc, char **argv)
+{
+	int hex = 0;
+	int argi = 1;
+
+	if (argi < argc && strcmp(argv[argi], "-x") == 0) {
+		hex = 1;
+		argi++;
+	}
+
+	if (argc - argi < 1 || argc - argi > 2) {
+		fprintf(stderr, "usage: %s [-x] trace.bin [other.bin]\n", argv[0]);
+		return 2;
+	}
+
+	static char screen[2][4096];
+	trace_t trace[2];
+	stats_t stats[2];
+	lcd_t lcd[MAX_CTRL];
+	int num_trace = argc - argi;
+
+	for (int i = 0; i < num_trace; i++) {
+		if (trace_load(argv[argi + i], &trace[i]))
+			return 1;
+		replay(&trace[i], lcd, &stats[i]);
+		render(&trace[i], lcd, hex, screen[i]);
+		report(argv[argi + i], &trace[i], &stats[i], screen[i]);
+		if (i + 1 < num_trace)
+			printf("\n");
+	}
+
+	if (num_trace == 2) {
+		uint64_t bus0 = stats[0].cmd_us + stats[0].data_us + stats[0].wait_us;
+		uint64_t bus1 = stats[1].cmd_us + stats[1].data_us + stats[1].wait_us;
+		printf("\nfinal screens %s\n", strcmp(screen[0], screen[1]) ? "DIFFER" : "match");
+		printf("  bytes   %lu -> %lu\n", stats[0].num_cmd + stats[0].num_data, stats[1].num_cmd + stats[1].num_data);
+		printf("  bus us  %llu -> %llu\n", (unsigned long long)bus0, (unsigned long long)bus1);
+	}
+
+	for (int i = 0; i < num_trace; i++)
+		free(trace[i].events);
+
+	return 0;
+}